@@ -0,0 +1,287 @@
+#include "BatchRunner.h"
+#include "FilterPipeline.h"
+#include "ParameterSweep.h"
+#include "TiledProcessor.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+
+// Side of a contact-sheet cell written next to the sweep results.
+static const int kSweepSheetCell = 256;
+
+bool BatchRunner::isRequested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--batch") == 0) return true;
+    }
+    return false;
+}
+
+int BatchRunner::main(const QStringList& args) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ImageLabQt - processamento em lote");
+    parser.addHelpOption();
+    parser.addOption({ "batch", "Executa sem interface gráfica." });
+    parser.addOption({ "input", "Arquivos de entrada (diretório ou padrão, ex.: fotos/*.jpg).", "glob" });
+    parser.addOption({ "config", "Configuração de filtro em JSON (formato de session.json).", "file" });
+    parser.addOption({ "output", "Diretório de saída.", "dir" });
+    parser.addOption({ "format", "Extensão de saída (png, jpg, ...). Padrão: a da entrada.", "ext" });
+    parser.addOption({ "jobs", "Número de workers (padrão: núcleos disponíveis).", "n" });
+    parser.addOption({ "tile-mem", "Processa em blocos com este limite de memória (MB), para imagens maiores que a RAM.", "mb" });
+    parser.addOption({ "sweep", "Varre um parâmetro: [etapa.]nome=início:fim:passo ou =v1,v2,... (repetível).", "spec" });
+    parser.process(args);
+
+    QTextStream err(stderr);
+    Options o;
+    o.inputGlob = parser.value("input");
+    o.configPath = parser.value("config");
+    o.outputDir = parser.value("output");
+    o.format = parser.value("format");
+    o.jobs = parser.value("jobs").toInt();
+    o.tileMemoryBytes = qint64(parser.value("tile-mem").toInt()) << 20;
+    o.sweepAxes = parser.values("sweep");
+    if (o.inputGlob.isEmpty() || o.configPath.isEmpty() || o.outputDir.isEmpty()) {
+        err << "Uso: ImageLabQt --batch --input <glob> --config <json> --output <dir> [--jobs N] [--format ext] [--tile-mem MB]"
+               " [--sweep spec ...]\n";
+        return 2;
+    }
+    return BatchRunner(o).exec();
+}
+
+QStringList BatchRunner::expandGlob(const QString& glob) {
+    static const QStringList imageFilters = { "*.png", "*.jpg", "*.jpeg", "*.bmp", "*.tif", "*.tiff", "*.webp" };
+
+    QFileInfo fi(glob);
+    QDir dir;
+    QStringList filters;
+    if (fi.isDir()) {
+        dir = QDir(fi.absoluteFilePath());
+        filters = imageFilters;
+    } else {
+        dir = fi.absoluteDir();
+        filters << fi.fileName();
+    }
+
+    QStringList out;
+    const auto names = dir.entryList(filters, QDir::Files, QDir::Name | QDir::IgnoreCase);
+    for (const auto& n : names) out << dir.absoluteFilePath(n);
+    return out;
+}
+
+bool BatchRunner::loadStages(const QString& path, QList<FilterConfig>& stages, QString* error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("não foi possível abrir %1").arg(path);
+        return false;
+    }
+    QJsonParseError pe;
+    const auto doc = QJsonDocument::fromJson(f.readAll(), &pe);
+    if (pe.error != QJsonParseError::NoError) {
+        if (error) *error = pe.errorString();
+        return false;
+    }
+
+    stages.clear();
+    if (doc.isArray()) {
+        for (const auto& v : doc.array()) {
+            FilterConfig cfg;
+            SessionStore::fromJson(v.toObject(), cfg);
+            stages.push_back(cfg);
+        }
+    } else if (doc.object().contains("name")) {
+        FilterConfig cfg;
+        SessionStore::fromJson(doc.object(), cfg);
+        stages.push_back(cfg);
+    } else {
+        stages = SessionStore::stagesFromJson(doc.object());
+    }
+    if (stages.isEmpty()) {
+        if (error) *error = "nenhuma etapa de filtro";
+        return false;
+    }
+    // An unknown name would pass images through unfiltered.
+    const QStringList known = SessionStore::filterNames();
+    for (int i = 0; i < stages.size(); ++i) {
+        stages[i].name = SessionStore::mapLegacyFilterName(stages[i].name);
+        if (!known.contains(stages[i].name)) {
+            if (error) *error = QString("filtro desconhecido na etapa %1: \"%2\"").arg(i + 1).arg(stages[i].name);
+            return false;
+        }
+    }
+    return true;
+}
+
+QString BatchRunner::outputPathFor(const QString& input, const QString& suffix) const {
+    QFileInfo fi(input);
+    const QString ext = opts.format.isEmpty() ? fi.suffix() : opts.format;
+    return QDir(opts.outputDir).filePath(fi.completeBaseName() + suffix + "." + ext);
+}
+
+int BatchRunner::exec() {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QList<FilterConfig> stages;
+    QString error;
+    if (!loadStages(opts.configPath, stages, &error)) {
+        err << "Configuração inválida: " << error << "\n";
+        return 2;
+    }
+    if (!opts.sweepAxes.isEmpty() && opts.tileMemoryBytes > 0) {
+        err << "--sweep e --tile-mem não podem ser usados juntos\n";
+        return 2;
+    }
+    if (opts.tileMemoryBytes > 0 && !TiledProcessor::supports(stages, &error)) {
+        err << "Processamento em blocos indisponível: " << error << "\n";
+        return 2;
+    }
+    const QStringList files = expandGlob(opts.inputGlob);
+    if (files.isEmpty()) {
+        err << "Nenhum arquivo corresponde a " << opts.inputGlob << "\n";
+        return 1;
+    }
+    if (!QDir().mkpath(opts.outputDir)) {
+        err << "Não foi possível criar " << opts.outputDir << "\n";
+        return 2;
+    }
+
+    if (!opts.sweepAxes.isEmpty()) return execSweep(stages, files);
+
+    const int jobs = qMax(1, opts.jobs > 0 ? opts.jobs : QThread::idealThreadCount());
+    // Parallelism comes from running images side by side; letting OpenCV
+    // also fan out inside each call would oversubscribe the cores.
+    const int cvThreads = cv::getNumThreads();
+    if (jobs > 1) cv::setNumThreads(1);
+
+    std::atomic<int> next { 0 };
+    std::atomic<int> done { 0 };
+    QMutex failMutex;
+    QStringList failures;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    for (int w = 0; w < jobs; ++w) {
+        pool.start([&]{
+            FilterPipeline pipeline;
+            TiledProcessor tiled(opts.tileMemoryBytes / jobs);
+            for (int i = next++; i < files.size(); i = next++) {
+                const QString& in = files[i];
+                QString why;
+                if (opts.tileMemoryBytes > 0) {
+                    if (tiled.process(in, outputPathFor(in), stages, &why)) ++done;
+                    else if (why.isEmpty()) why = "falha no processamento em blocos";
+                } else {
+                    cv::Mat src = cv::imread(in.toStdString(), cv::IMREAD_COLOR);
+                    if (src.empty()) {
+                        why = "falha ao decodificar";
+                    } else {
+                        cv::Mat res = pipeline.run(src, stages);
+                        pipeline.clear();
+                        if (res.empty() || !cv::imwrite(outputPathFor(in).toStdString(), res))
+                            why = "falha ao gravar";
+                        else
+                            ++done;
+                    }
+                }
+                if (!why.isEmpty()) {
+                    QMutexLocker lock(&failMutex);
+                    failures << QString("%1: %2").arg(in, why);
+                }
+            }
+        });
+    }
+    pool.waitForDone();
+
+    const double secs = timer.elapsed() / 1000.0;
+    cv::setNumThreads(cvThreads);
+
+    for (const auto& f : failures) err << f << "\n";
+    out << QString("%1 de %2 imagens processadas em %3 s (%4 imagens/s, %5 workers)\n")
+               .arg(done.load()).arg(files.size())
+               .arg(secs, 0, 'f', 2)
+               .arg(secs > 0 ? done.load() / secs : 0.0, 0, 'f', 2)
+               .arg(jobs);
+    return failures.isEmpty() ? 0 : 1;
+}
+
+int BatchRunner::execSweep(const QList<FilterConfig>& stages, const QStringList& files) {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QList<ParameterSweep::Axis> axes;
+    for (const QString& spec : opts.sweepAxes) {
+        ParameterSweep::Axis ax;
+        QString why;
+        if (!ParameterSweep::parseAxis(spec, ax, &why)) {
+            err << "Varredura inválida: " << why << "\n";
+            return 2;
+        }
+        axes.push_back(ax);
+    }
+    ParameterSweep sweep(stages, axes);
+    QString why;
+    if (!sweep.validate(&why)) {
+        err << "Varredura inválida: " << why << "\n";
+        return 2;
+    }
+
+    const int cells = sweep.cellCount();
+    QStringList labels, suffixes;
+    for (int c = 0; c < cells; ++c) {
+        labels << sweep.labelFor(c);
+        suffixes << "_" + QString(labels.last()).replace(' ', '_').replace('=', '-');
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int written = 0;
+    QStringList failures;
+    for (const QString& in : files) {
+        cv::Mat src = cv::imread(in.toStdString(), cv::IMREAD_COLOR);
+        if (src.empty()) {
+            failures << QString("%1: falha ao decodificar").arg(in);
+            continue;
+        }
+        QMutex mutex;
+        std::vector<cv::Mat> thumbs(cells);
+        std::atomic<int> ok { 0 };
+        sweep.run(src, [&](int cell, const cv::Mat& result) {
+            const double f = std::min(1.0, double(kSweepSheetCell) / std::max(result.cols, result.rows));
+            cv::Mat thumb;
+            cv::resize(result, thumb, cv::Size(), f, f, cv::INTER_AREA);
+            thumbs[cell] = thumb;
+            if (cv::imwrite(outputPathFor(in, suffixes[cell]).toStdString(), result)) {
+                ++ok;
+            } else {
+                QMutexLocker lock(&mutex);
+                failures << QString("%1 [%2]: falha ao gravar").arg(in, labels[cell]);
+            }
+        });
+        const QString sheetPath = QDir(opts.outputDir).filePath(QFileInfo(in).completeBaseName() + "_sweep.png");
+        if (!cv::imwrite(sheetPath.toStdString(), ParameterSweep::contactSheet(thumbs, labels, sweep.columns(), kSweepSheetCell)))
+            failures << QString("%1: falha ao gravar a folha de contatos").arg(in);
+        written += ok.load();
+    }
+
+    const double secs = timer.elapsed() / 1000.0;
+    for (const auto& f : failures) err << f << "\n";
+    out << QString("%1 imagens x %2 combinações: %3 arquivos gravados em %4 s\n")
+               .arg(files.size()).arg(cells).arg(written).arg(secs, 0, 'f', 2);
+    return failures.isEmpty() ? 0 : 1;
+}
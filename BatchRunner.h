@@ -0,0 +1,45 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "SessionStore.h"
+
+// Headless mode: ImageLabQt --batch --input "<dir>/*.jpg" --config cfg.json --output <dir>
+// Applies the same filter pipeline as the GUI to every matching file using a
+// pool of workers; each worker carries one image through decode -> filter ->
+// encode, so at most `jobs` decoded images are in memory at once.
+//
+// With --sweep param=start:end:step (repeatable) every image is instead run
+// over the parameter grid (ParameterSweep): one file per cell plus a contact
+// sheet, <name>_sweep.png. Images go one at a time; the grid itself runs in
+// parallel.
+class BatchRunner {
+public:
+    struct Options {
+        QString inputGlob;
+        QString configPath;
+        QString outputDir;
+        QString format;
+        int jobs = 0;
+        // When > 0, every image is streamed through TiledProcessor in strips
+        // and this ceiling is shared between the workers.
+        qint64 tileMemoryBytes = 0;
+        QStringList sweepAxes;
+    };
+
+    static bool isRequested(int argc, char* argv[]);
+    static int main(const QStringList& args);
+
+    explicit BatchRunner(Options opts) : opts(std::move(opts)) {}
+    int exec();
+
+    static QStringList expandGlob(const QString& glob);
+    static bool loadStages(const QString& path, QList<FilterConfig>& stages, QString* error = nullptr);
+
+private:
+    QString outputPathFor(const QString& input, const QString& suffix = QString()) const;
+    int execSweep(const QList<FilterConfig>& stages, const QStringList& files);
+
+    Options opts;
+};
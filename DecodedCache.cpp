@@ -0,0 +1,166 @@
+#include "DecodedCache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const char kMagic[4] = { 'I', 'L', 'Q', 'D' };
+const quint32 kVersion = 1;
+// Pixel rows start here, keeping them cache-line aligned in the mapping.
+const qint64 kDataOffset = 64;
+
+struct RawHeader {
+    char magic[4];
+    quint32 version;
+    qint32 rows;
+    qint32 cols;
+    qint32 type;
+    quint32 reserved;
+    quint64 step;
+    quint64 pixelHash;
+};
+static_assert(sizeof(RawHeader) <= kDataOffset, "header must fit before the pixel data");
+
+// Owns the QFile behind a mapped Mat: OpenCV calls unmap() when the last
+// reference is released, and that unmaps and closes the file.
+class MappedFileAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+        return nullptr; // only wraps existing mappings
+    }
+    bool allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override { return false; }
+    void deallocate(cv::UMatData* u) const override {
+        if (!u) return;
+        auto* file = static_cast<QFile*>(u->handle);
+        file->unmap(u->origdata - kDataOffset);
+        delete file;
+        delete u;
+    }
+};
+
+MappedFileAllocator* mappedAllocator() {
+    static MappedFileAllocator allocator;
+    return &allocator;
+}
+
+}
+
+DecodedCache::DecodedCache(QString directory, qint64 quota)
+    : dir(directory.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/decoded"
+                              : std::move(directory))
+    , quotaBytes(quota)
+{
+}
+
+QByteArray DecodedCache::keyFor(const QString& sourcePath) {
+    const QFileInfo fi(sourcePath);
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    h.addData(fi.absoluteFilePath().toUtf8());
+    h.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    h.addData(QByteArray::number(fi.size()));
+    return h.result().toHex();
+}
+
+QString DecodedCache::entryPath(const QByteArray& key) const {
+    return dir + "/" + QString::fromLatin1(key) + ".raw";
+}
+
+bool DecodedCache::lookup(const QString& sourcePath, cv::Mat& out, quint64* pixelHash) {
+    if (!QFileInfo::exists(sourcePath)) return false;
+    auto file = std::make_unique<QFile>(entryPath(keyFor(sourcePath)));
+    if (!file->open(QIODevice::ReadOnly)) return false;
+
+    RawHeader hdr;
+    if (file->read(reinterpret_cast<char*>(&hdr), sizeof hdr) != qint64(sizeof hdr)) return false;
+    if (std::memcmp(hdr.magic, kMagic, 4) != 0 || hdr.version != kVersion || hdr.rows <= 0 || hdr.cols <= 0)
+        return false;
+    const qint64 dataBytes = qint64(hdr.step) * hdr.rows;
+    if (hdr.step < size_t(hdr.cols) * CV_ELEM_SIZE(hdr.type) || file->size() != kDataOffset + dataBytes) return false;
+
+    uchar* base = file->map(0, file->size(), QFileDevice::MapPrivateOption);
+    if (!base) return false;
+    uchar* data = base + kDataOffset;
+
+    cv::Mat m(hdr.rows, hdr.cols, hdr.type, data, size_t(hdr.step));
+    auto* u = new cv::UMatData(mappedAllocator());
+    u->data = u->origdata = data;
+    u->size = size_t(dataBytes);
+    u->handle = file.release();
+    u->refcount = 1;
+    m.allocator = mappedAllocator();
+    m.u = u;
+    out = m;
+
+    // Hits count as use for oldest-first eviction.
+    static_cast<QFile*>(u->handle)->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    if (pixelHash) *pixelHash = hdr.pixelHash;
+    return true;
+}
+
+bool DecodedCache::store(const QString& sourcePath, const cv::Mat& img, quint64 pixelHash) {
+    const qint64 quota = quotaBytes.load();
+    if (img.empty() || img.dims != 2 || quota <= 0) return false;
+    const qint64 rowBytes = qint64(img.cols) * img.elemSize();
+    if (kDataOffset + rowBytes * img.rows > quota) return false;
+    if (!QDir().mkpath(dir)) return false;
+
+    RawHeader hdr {};
+    std::memcpy(hdr.magic, kMagic, 4);
+    hdr.version = kVersion;
+    hdr.rows = img.rows;
+    hdr.cols = img.cols;
+    hdr.type = img.type();
+    hdr.step = quint64(rowBytes);
+    hdr.pixelHash = pixelHash;
+
+    QSaveFile f(entryPath(keyFor(sourcePath)));
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    QByteArray head(int(kDataOffset), '\0');
+    std::memcpy(head.data(), &hdr, sizeof hdr);
+    f.write(head);
+    for (int y = 0; y < img.rows; ++y)
+        f.write(reinterpret_cast<const char*>(img.ptr(y)), rowBytes);
+    if (!f.commit()) return false;
+
+    evict();
+    return true;
+}
+
+void DecodedCache::evict() {
+    QMutexLocker lock(&mutex);
+    QFileInfoList entries = QDir(dir).entryInfoList({ "*.raw" }, QDir::Files, QDir::Time | QDir::Reversed);
+    const qint64 quota = quotaBytes.load();
+    qint64 total = 0;
+    for (const auto& fi : entries) total += fi.size();
+    // Mapped entries can be unlinked safely; the mapping outlives the name.
+    for (const auto& fi : entries) {
+        if (total <= quota) break;
+        if (QFile::remove(fi.absoluteFilePath())) total -= fi.size();
+    }
+}
+
+void DecodedCache::setQuota(qint64 bytes) {
+    quotaBytes = bytes;
+    evict();
+}
+
+qint64 DecodedCache::diskUsage() const {
+    QMutexLocker lock(&mutex);
+    qint64 total = 0;
+    for (const auto& fi : QDir(dir).entryInfoList({ "*.raw" }, QDir::Files)) total += fi.size();
+    return total;
+}
+
+void DecodedCache::clear() {
+    QMutexLocker lock(&mutex);
+    for (const auto& fi : QDir(dir).entryInfoList({ "*.raw" }, QDir::Files)) QFile::remove(fi.absoluteFilePath());
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <opencv2/opencv.hpp>
+
+// On-disk cache of decoded originals. Each entry is a small header followed
+// by the raw pixel rows, so a hit is a memory map instead of a decode: the
+// returned Mat points straight into the mapping (copy-on-write, so a stray
+// in-place write never reaches the file) and unmaps it when its last
+// reference goes away.
+//
+// Entries are keyed by the source file's absolute path, modification time
+// and size; editing the file simply misses. Hits refresh the entry's mtime
+// and the oldest entries are evicted first once the directory exceeds the
+// disk quota. store() may run on any thread.
+class DecodedCache {
+public:
+    explicit DecodedCache(QString directory = QString(), qint64 quotaBytes = qint64(2048) << 20);
+
+    // `pixelHash` is returned as stored (ImageDocument::hashPixels of img),
+    // so a hit does not have to touch every page to rehash.
+    bool lookup(const QString& sourcePath, cv::Mat& out, quint64* pixelHash = nullptr);
+    bool store(const QString& sourcePath, const cv::Mat& img, quint64 pixelHash);
+
+    void setQuota(qint64 bytes);
+    qint64 quota() const { return quotaBytes.load(); }
+    qint64 diskUsage() const;
+    void clear();
+
+    QString directory() const { return dir; }
+
+private:
+    static QByteArray keyFor(const QString& sourcePath);
+    QString entryPath(const QByteArray& key) const;
+    void evict();
+
+    QString dir;
+    std::atomic<qint64> quotaBytes;
+    mutable QMutex mutex; // serializes eviction
+};
@@ -0,0 +1,223 @@
+#include "DocumentStore.h"
+#include "Profiler.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QPointer>
+#include <QThreadPool>
+#include <algorithm>
+#include <vector>
+
+// Fast PNG levels compress photos nearly as well as the slow ones.
+static const int kPngCompression = 1;
+
+static QString megabytes(qint64 bytes) {
+    const double mb = bytes / double(1 << 20);
+    return QString("%1 MB").arg(mb, 0, 'f', mb < 10 ? 1 : 0);
+}
+
+DocumentStore::DocumentStore(QObject* parent, qint64 budgetBytes)
+    : QObject(parent), budgetBytes(budgetBytes) {}
+
+int DocumentStore::indexOf(const QString& path) const {
+    const QString absolute = QFileInfo(path).absoluteFilePath();
+    for (int i = 0; i < entries.size(); ++i)
+        if (QFileInfo(entries[i].path).absoluteFilePath() == absolute) return i;
+    return -1;
+}
+
+qint64 DocumentStore::bytesAt(int index) const {
+    if (index == active) return activeBytes;
+    const Slot& s = entries[index];
+    switch (s.residency) {
+    case Residency::Resident: return s.doc.residentBytes() + s.undo.bytes();
+    case Residency::Compressed: return s.png.size();
+    case Residency::OnDisk: break;
+    }
+    return 0;
+}
+
+QString DocumentStore::label(int index) const {
+    const QString name = QFileInfo(entries[index].path).fileName();
+    switch (index == active ? Residency::Resident : entries[index].residency) {
+    case Residency::Resident: return QString("%1 · %2").arg(name, megabytes(bytesAt(index)));
+    case Residency::Compressed: return QString("%1 · PNG %2").arg(name, megabytes(bytesAt(index)));
+    case Residency::OnDisk: break;
+    }
+    return QString("%1 · em disco").arg(name);
+}
+
+qint64 DocumentStore::usage() const {
+    qint64 total = 0;
+    for (int i = 0; i < entries.size(); ++i) total += bytesAt(i);
+    return total;
+}
+
+int DocumentStore::open(ImageDocument& current, UndoStack& undo, ImageDocument&& doc) {
+    park(current, undo);
+    Slot s;
+    s.id = nextId++;
+    s.path = doc.lastPath();
+    s.lastUsed = ++clock;
+    entries.push_back(std::move(s));
+    current = std::move(doc);
+    active = entries.size() - 1;
+    activeBytes = current.residentBytes();
+    enforceBudget();
+    emit changed();
+    return active;
+}
+
+bool DocumentStore::activate(int index, ImageDocument& current, UndoStack& undo, QString* error) {
+    if (index == active) return true;
+    Slot& s = entries[index];
+    if (!promote(s, error)) return false;
+    park(current, undo);
+    current = std::move(s.doc);
+    s.doc = ImageDocument();
+    undo.restore(std::move(s.undo));
+    s.undo = UndoStack::History();
+    s.lastUsed = ++clock;
+    active = index;
+    activeBytes = current.residentBytes();
+    enforceBudget();
+    emit changed();
+    return true;
+}
+
+void DocumentStore::close(int index) {
+    entries.removeAt(index);
+    if (index == active) {
+        active = -1;
+        activeBytes = 0;
+    } else if (index < active) {
+        --active;
+    }
+    emit changed();
+}
+
+void DocumentStore::updateActive(const ImageDocument& current) {
+    const qint64 bytes = current.residentBytes();
+    if (active < 0 || bytes == activeBytes) return;
+    activeBytes = bytes;
+    enforceBudget();
+    emit changed();
+}
+
+void DocumentStore::setBudget(qint64 bytes) {
+    budgetBytes = bytes;
+    enforceBudget();
+    emit changed();
+}
+
+void DocumentStore::park(ImageDocument& current, UndoStack& undo) {
+    if (active < 0) return;
+    Slot& s = entries[active];
+    s.doc = std::move(current);
+    s.undo = undo.take();
+    s.residency = Residency::Resident;
+    s.png.clear();
+    s.lastUsed = ++clock;
+    active = -1;
+    activeBytes = 0;
+}
+
+bool DocumentStore::promote(Slot& s, QString* error) {
+    IMAGELAB_TRACE_SCOPE("DocumentStore::promote");
+    switch (s.residency) {
+    case Residency::Resident:
+        return true;
+    case Residency::Compressed: {
+        const std::vector<uchar> buf(s.png.cbegin(), s.png.cend());
+        cv::Mat img = cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+        if (img.empty()) break;
+        s.doc.adopt(s.path, std::move(img), s.doc.contentHash());
+        s.png.clear();
+        s.residency = Residency::Resident;
+        return true;
+    }
+    case Residency::OnDisk:
+        // Usually a hit in the decoded cache; large JPEGs may come back
+        // reduced, and the window decodes them in full as after opening.
+        if (!s.doc.load(s.path, true)) break;
+        s.residency = Residency::Resident;
+        return true;
+    }
+    if (error) *error = QString("não foi possível recarregar %1").arg(s.path);
+    return false;
+}
+
+void DocumentStore::enforceBudget() {
+    qint64 used = usage();
+    if (used <= budgetBytes) return;
+
+    // Least recently used first; the active document is never touched.
+    QList<int> order;
+    for (int i = 0; i < entries.size(); ++i)
+        if (i != active) order.push_back(i);
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return entries[a].lastUsed < entries[b].lastUsed;
+    });
+
+    // Results are rendered again (or found in the result cache) on
+    // activation; undo states keep their stages and are recomputed likewise.
+    for (int i : order) {
+        if (used <= budgetBytes) return;
+        Slot& s = entries[i];
+        if (s.residency != Residency::Resident) continue;
+        const qint64 before = bytesAt(i);
+        s.doc.dropProcessed();
+        s.undo.dropPixels();
+        used -= before - bytesAt(i);
+    }
+    // Compression finishes later; count the original as gone so only as many
+    // documents as needed are queued. Reduced decodes are cheaper to decode
+    // again than to compress.
+    for (int i : order) {
+        if (used <= budgetBytes) return;
+        Slot& s = entries[i];
+        if (s.residency != Residency::Resident || s.compressing || !s.doc.hasImage() || s.doc.isReduced()) continue;
+        used -= s.doc.residentBytes();
+        compress(s);
+    }
+    // Still over: keep only the path of documents that can be read again.
+    for (int i : order) {
+        if (used <= budgetBytes) return;
+        Slot& s = entries[i];
+        if (s.residency == Residency::OnDisk || s.compressing || !QFileInfo::exists(s.path)) continue;
+        used -= bytesAt(i);
+        s.doc.unload();
+        s.png.clear();
+        s.residency = Residency::OnDisk;
+    }
+}
+
+void DocumentStore::compress(Slot& s) {
+    s.compressing = true;
+    const quint64 id = s.id;
+    const quint64 gen = s.doc.generation();
+    const cv::Mat img = s.doc.originalMat();
+    QPointer<DocumentStore> self(this);
+    QThreadPool::globalInstance()->start([self, id, gen, img] {
+        IMAGELAB_TRACE_SCOPE("DocumentStore::compress");
+        std::vector<uchar> buf;
+        const bool ok = cv::imencode(".png", img, buf, { cv::IMWRITE_PNG_COMPRESSION, kPngCompression });
+        const QByteArray png = ok ? QByteArray(reinterpret_cast<const char*>(buf.data()), int(buf.size())) : QByteArray();
+        QMetaObject::invokeMethod(qApp, [self, id, gen, png] {
+            if (!self) return;
+            for (int i = 0; i < self->entries.size(); ++i) {
+                Slot& s = self->entries[i];
+                if (s.id != id) continue;
+                s.compressing = false;
+                // Activated meanwhile: keep the pixels at hand.
+                if (i == self->active || png.isEmpty() || s.doc.generation() != gen) break;
+                s.png = png;
+                s.doc.unload();
+                s.residency = Residency::Compressed;
+                self->enforceBudget();
+                emit self->changed();
+                break;
+            }
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include "ImageDocument.h"
+#include "UndoStack.h"
+
+// The open documents, one per tab. The active one lives in the window (it is
+// handed out by activate() and parked again on the next switch, together
+// with its undo history); the others are kept here and demoted, least
+// recently used first, while everything together exceeds the memory budget:
+// their processed results and undo pixels are dropped,
+// then the originals are PNG-compressed on the thread pool and, if that is
+// still too much, released and decoded again from the file (or the decoded
+// cache) when their tab is activated.
+class DocumentStore : public QObject {
+    Q_OBJECT
+public:
+    enum class Residency { Resident, Compressed, OnDisk };
+
+    explicit DocumentStore(QObject* parent = nullptr, qint64 budgetBytes = qint64(1536) << 20);
+
+    int count() const { return entries.size(); }
+    int activeIndex() const { return active; }
+    int indexOf(const QString& path) const;
+    QString pathAt(int index) const { return entries[index].path; }
+    Residency residencyAt(int index) const { return entries[index].residency; }
+    // Bytes this document holds right now (PNG size while compressed).
+    qint64 bytesAt(int index) const;
+    // "name.jpg · 48 MB", "name.jpg · PNG 12 MB" or "name.jpg · em disco".
+    QString label(int index) const;
+
+    // Adds a slot for `doc` and makes it active; `current` (the previously
+    // active document, if any) and the states in `undo` are parked first.
+    // `doc` is moved into `current`, and `undo` is left empty.
+    int open(ImageDocument& current, UndoStack& undo, ImageDocument&& doc);
+    // Parks `current` and `undo`, then hands out document `index` and its
+    // undo history in their place, promoted back to memory. On failure
+    // nothing changes.
+    bool activate(int index, ImageDocument& current, UndoStack& undo, QString* error = nullptr);
+    // Closing the active document leaves none active; the window clears it.
+    void close(int index);
+    // Called whenever the active document's pixels change, so it counts
+    // toward the budget.
+    void updateActive(const ImageDocument& current);
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return budgetBytes; }
+    qint64 usage() const;
+
+signals:
+    void changed();
+
+private:
+    struct Slot {
+        quint64 id = 0;
+        ImageDocument doc;   // moved out while active
+        UndoStack::History undo; // likewise
+        QString path;
+        Residency residency = Residency::Resident;
+        QByteArray png;
+        bool compressing = false;
+        quint64 lastUsed = 0;
+    };
+
+    void park(ImageDocument& current, UndoStack& undo);
+    bool promote(Slot& s, QString* error);
+    void enforceBudget();
+    void compress(Slot& s);
+
+    QList<Slot> entries;
+    int active = -1;
+    qint64 activeBytes = 0;
+    quint64 nextId = 1;
+    quint64 clock = 0;
+    qint64 budgetBytes;
+};
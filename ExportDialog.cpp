@@ -0,0 +1,100 @@
+#include "ExportDialog.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QVBoxLayout>
+
+ExportDialog::ExportDialog(const QString& path, const ExportQueue::EncoderOptions& opts, QWidget* parent)
+    : QDialog(parent), path(path)
+{
+    setWindowTitle("Opções de exportação");
+
+    sbPng = new QSpinBox(this); sbPng->setRange(0, 9); sbPng->setValue(opts.pngCompression);
+    sbJpeg = new QSpinBox(this); sbJpeg->setRange(1, 100); sbJpeg->setValue(opts.jpegQuality);
+    cbProgressive = new QCheckBox("Progressivo", this); cbProgressive->setChecked(opts.jpegProgressive);
+    sbWebp = new QSpinBox(this); sbWebp->setRange(1, 100); sbWebp->setValue(opts.webpQuality);
+    cbLossless = new QCheckBox("Sem perdas", this); cbLossless->setChecked(opts.webpLossless);
+    connect(cbLossless, &QCheckBox::toggled, sbWebp, &QWidget::setDisabled);
+    sbWebp->setDisabled(opts.webpLossless);
+    cbTiff = new QComboBox(this);
+    cbTiff->addItem("Nenhuma", 1);
+    cbTiff->addItem("LZW", 5);
+    cbTiff->addItem("Deflate", 8);
+    cbTiff->setCurrentIndex(qMax(0, cbTiff->findData(opts.tiffCompression)));
+
+    auto* jpegRow = new QHBoxLayout;
+    jpegRow->addWidget(sbJpeg, 1);
+    jpegRow->addWidget(cbProgressive);
+    auto* webpRow = new QHBoxLayout;
+    webpRow->addWidget(sbWebp, 1);
+    webpRow->addWidget(cbLossless);
+
+    const QString ext = QFileInfo(path).suffix().toLower();
+    auto* formatsRow = new QHBoxLayout;
+    for (const QString& f : { QString("png"), QString("jpg"), QString("webp"), QString("tif") }) {
+        if (f == ext || (f == "jpg" && ext == "jpeg") || (f == "tif" && ext == "tiff")) continue;
+        auto* cb = new QCheckBox(f.toUpper(), this);
+        formatsRow->addWidget(cb);
+        extraFormats.push_back({ f, cb });
+    }
+    formatsRow->addStretch(1);
+    leSizes = new QLineEdit(this);
+    leSizes->setPlaceholderText("ex.: 2048, 1024");
+
+    auto* form = new QFormLayout;
+    form->addRow("Compressão PNG (0-9):", sbPng);
+    form->addRow("Qualidade JPEG:", jpegRow);
+    form->addRow("Qualidade WebP:", webpRow);
+    form->addRow("Compressão TIFF:", cbTiff);
+    form->addRow("Gravar também em:", formatsRow);
+    form->addRow("Tamanhos adicionais (lado maior, px):", leSizes);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* v = new QVBoxLayout(this);
+    v->addLayout(form);
+    v->addWidget(buttons);
+}
+
+ExportQueue::EncoderOptions ExportDialog::options() const
+{
+    ExportQueue::EncoderOptions o;
+    o.pngCompression = sbPng->value();
+    o.jpegQuality = sbJpeg->value();
+    o.jpegProgressive = cbProgressive->isChecked();
+    o.webpQuality = sbWebp->value();
+    o.webpLossless = cbLossless->isChecked();
+    o.tiffCompression = cbTiff->currentData().toInt();
+    return o;
+}
+
+QList<ExportQueue::Target> ExportDialog::targets() const
+{
+    const QFileInfo fi(path);
+    QStringList exts { fi.suffix() };
+    for (const auto& f : extraFormats)
+        if (f.second->isChecked()) exts << f.first;
+
+    QList<int> sizes { 0 };
+    for (const QString& s : leSizes->text().split(',', Qt::SkipEmptyParts)) {
+        const int side = s.trimmed().toInt();
+        if (side > 0 && !sizes.contains(side)) sizes << side;
+    }
+
+    QList<ExportQueue::Target> out;
+    const QDir dir = fi.absoluteDir();
+    for (int side : sizes) {
+        const QString base = side > 0 ? QString("%1_%2px").arg(fi.completeBaseName()).arg(side) : fi.completeBaseName();
+        for (const QString& e : exts) out.push_back({ dir.filePath(base + "." + e), side });
+    }
+    return out;
+}
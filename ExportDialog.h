@@ -0,0 +1,34 @@
+#pragma once
+#include <QDialog>
+#include <QList>
+#include <QPair>
+
+#include "ExportQueue.h"
+
+class QCheckBox;
+class QComboBox;
+class QLineEdit;
+class QSpinBox;
+
+// Encoder settings and extra outputs for one export. Besides the chosen
+// file, the same result can be written in other formats and at smaller
+// sizes (name_1024px.jpg, ...), all from one buffer.
+class ExportDialog : public QDialog {
+    Q_OBJECT
+public:
+    ExportDialog(const QString& path, const ExportQueue::EncoderOptions& opts, QWidget* parent = nullptr);
+
+    ExportQueue::EncoderOptions options() const;
+    QList<ExportQueue::Target> targets() const;
+
+private:
+    QString path;
+    QSpinBox* sbPng = nullptr;
+    QSpinBox* sbJpeg = nullptr;
+    QCheckBox* cbProgressive = nullptr;
+    QSpinBox* sbWebp = nullptr;
+    QCheckBox* cbLossless = nullptr;
+    QComboBox* cbTiff = nullptr;
+    QList<QPair<QString, QCheckBox*>> extraFormats;
+    QLineEdit* leSizes = nullptr;
+};
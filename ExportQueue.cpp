@@ -0,0 +1,114 @@
+#include "ExportQueue.h"
+#include "FilterPipeline.h"
+#include "Profiler.h"
+
+#include <QFileInfo>
+#include <QMap>
+#include <QThread>
+#include <algorithm>
+
+ExportQueue::ExportQueue(QObject* parent) : QObject(parent) {
+    // Leave cores for the filter worker and the viewer while exporting.
+    pool.setMaxThreadCount(std::max(2, QThread::idealThreadCount() / 2));
+}
+
+ExportQueue::~ExportQueue() {
+    // Let queued files finish rather than leave them half written.
+    pool.waitForDone();
+}
+
+std::vector<int> ExportQueue::encoderParams(const QString& path, const EncoderOptions& o) {
+    const QString ext = QFileInfo(path).suffix().toLower();
+    if (ext == "png") return { cv::IMWRITE_PNG_COMPRESSION, o.pngCompression };
+    if (ext == "jpg" || ext == "jpeg")
+        return { cv::IMWRITE_JPEG_QUALITY, o.jpegQuality, cv::IMWRITE_JPEG_PROGRESSIVE, o.jpegProgressive ? 1 : 0 };
+    // OpenCV treats WebP quality above 100 as lossless.
+    if (ext == "webp") return { cv::IMWRITE_WEBP_QUALITY, o.webpLossless ? 101 : o.webpQuality };
+    if (ext == "tif" || ext == "tiff") return { cv::IMWRITE_TIFF_COMPRESSION, o.tiffCompression };
+    return {};
+}
+
+void ExportQueue::submit(const cv::Mat& image, const QList<Target>& targets, const EncoderOptions& opts) {
+    if (targets.isEmpty()) return;
+    total += targets.size();
+    emit progress(done, total);
+    encodeAll(image, targets, opts);
+}
+
+void ExportQueue::submit(const cv::Mat& source, const QList<FilterConfig>& stages,
+                         const QList<Target>& targets, const EncoderOptions& opts) {
+    if (targets.isEmpty()) return;
+    total += targets.size();
+    emit progress(done, total);
+    pool.start([this, source, stages, targets, opts]{
+        const cv::Mat image = FilterPipeline().run(source, stages);
+        if (image.empty()) failAll(targets);
+        else encodeAll(image, targets, opts);
+    });
+}
+
+void ExportQueue::submit(const QString& sourcePath, const QList<FilterConfig>& stages,
+                         const QList<Target>& targets, const EncoderOptions& opts) {
+    if (targets.isEmpty()) return;
+    total += targets.size();
+    emit progress(done, total);
+    pool.start([this, sourcePath, stages, targets, opts]{
+        cv::Mat source;
+        {
+            IMAGELAB_TRACE_SCOPE("ExportQueue::decode");
+            source = cv::imread(sourcePath.toStdString(), cv::IMREAD_COLOR);
+        }
+        const cv::Mat image = source.empty() ? cv::Mat() : FilterPipeline().run(source, stages);
+        if (image.empty()) failAll(targets);
+        else encodeAll(image, targets, opts);
+    });
+}
+
+// Safe from pool threads: the results are posted to the queue's thread.
+void ExportQueue::failAll(const QList<Target>& targets) {
+    for (const Target& t : targets)
+        QMetaObject::invokeMethod(this, [this, path = t.path]{ finishOne(path, false); }, Qt::QueuedConnection);
+}
+
+void ExportQueue::encodeAll(const cv::Mat& image, const QList<Target>& targets, const EncoderOptions& opts) {
+    QMap<int, QList<Target>> bySize;
+    for (const Target& t : targets) bySize[t.maxSide].push_back(t);
+
+    for (auto it = bySize.cbegin(); it != bySize.cend(); ++it) {
+        const int side = it.key();
+        const QList<Target> group = it.value();
+        pool.start([this, image, side, group, opts]{
+            cv::Mat sized = image;
+            const int longer = std::max(image.cols, image.rows);
+            if (side > 0 && side < longer) {
+                IMAGELAB_TRACE_SCOPE("ExportQueue::resize");
+                const double f = double(side) / longer;
+                cv::resize(image, sized, cv::Size(), f, f, cv::INTER_AREA);
+            }
+            for (const Target& t : group) {
+                pool.start([this, sized, t, opts]{
+                    IMAGELAB_TRACE_SCOPE(QString("ExportQueue::encode %1").arg(QFileInfo(t.path).suffix()));
+                    bool ok = false;
+                    try {
+                        ok = cv::imwrite(t.path.toStdString(), sized, encoderParams(t.path, opts));
+                    } catch (const cv::Exception&) {
+                        // Unsupported format or option in this OpenCV build.
+                    }
+                    QMetaObject::invokeMethod(this, [this, path = t.path, ok]{ finishOne(path, ok); },
+                                              Qt::QueuedConnection);
+                });
+            }
+        });
+    }
+}
+
+void ExportQueue::finishOne(const QString& path, bool ok) {
+    ++done;
+    if (!ok) ++failed;
+    emit written(path, ok);
+    emit progress(done, total);
+    if (done < total) return;
+    const int count = total, bad = failed;
+    total = done = failed = 0;
+    emit idle(count, bad);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "SessionStore.h"
+
+// Writes exports on a background pool so encoding never blocks the UI. One
+// submit() can fan a single buffer out to several files: targets of the same
+// size share one downscale, and every file is encoded as its own task, so a
+// PNG, a JPEG and a WebP of the same result are written side by side.
+class ExportQueue : public QObject {
+    Q_OBJECT
+public:
+    struct EncoderOptions {
+        int pngCompression = 3;    // 0-9
+        int jpegQuality = 95;      // 1-100
+        bool jpegProgressive = false;
+        int webpQuality = 90;      // 1-100
+        bool webpLossless = false;
+        int tiffCompression = 5;   // libtiff code: 1 none, 5 LZW, 8 Deflate
+    };
+
+    struct Target {
+        QString path;              // the format follows the extension
+        int maxSide = 0;           // longer side in pixels; 0 keeps the size
+    };
+
+    explicit ExportQueue(QObject* parent = nullptr);
+    ~ExportQueue() override;
+
+    // `image` is shared, not copied; results are never modified in place.
+    void submit(const cv::Mat& image, const QList<Target>& targets, const EncoderOptions& opts);
+    // Renders `stages` on `source` at full resolution first.
+    void submit(const cv::Mat& source, const QList<FilterConfig>& stages,
+                const QList<Target>& targets, const EncoderOptions& opts);
+    // Decodes `sourcePath` in full on the pool, then renders as above. Used
+    // while the window only holds a reduced decode.
+    void submit(const QString& sourcePath, const QList<FilterConfig>& stages,
+                const QList<Target>& targets, const EncoderOptions& opts);
+
+    bool isBusy() const { return done < total; }
+
+    static std::vector<int> encoderParams(const QString& path, const EncoderOptions& opts);
+
+signals:
+    void progress(int done, int total);
+    void written(const QString& path, bool ok);
+    // Everything queued so far is written; `failed` of `count` files failed.
+    void idle(int count, int failed);
+
+private:
+    void encodeAll(const cv::Mat& image, const QList<Target>& targets, const EncoderOptions& opts);
+    void failAll(const QList<Target>& targets);
+    void finishOne(const QString& path, bool ok);
+
+    QThreadPool pool;
+    // Only touched on the thread that owns the queue.
+    int total = 0;
+    int done = 0;
+    int failed = 0;
+};
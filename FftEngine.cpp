@@ -0,0 +1,164 @@
+#include "FftEngine.h"
+#include "MatPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// One per FilterPipeline lane that can reach a frequency stage (preview and
+// full resolution; region renders never do).
+static const size_t kMaxSpectra = 2;
+
+static bool sameBuffer(const cv::Mat& a, const cv::Mat& b) {
+    return a.data == b.data && a.size == b.size && a.type() == b.type() && a.step[0] == b.step[0];
+}
+
+bool FftEngine::FrequencyFilter::operator==(const FrequencyFilter& o) const {
+    return kind == o.kind && shape == o.shape && cutoff == o.cutoff && order == o.order
+        && notchU == o.notchU && notchV == o.notchV && notchRadius == o.notchRadius;
+}
+
+void FftEngine::clear() {
+    spectra.clear();
+    scratch = Scratch();
+    mask.release();
+}
+
+cv::Mat FftEngine::forward(const cv::Mat& plane, cv::Size padded) {
+    cv::Mat f;
+    plane.convertTo(f, CV_32F);
+    if (padded != plane.size()) {
+        cv::copyMakeBorder(f, f, 0, padded.height - plane.rows, 0, padded.width - plane.cols,
+                           cv::BORDER_REFLECT);
+    }
+    cv::Mat spec;
+    cv::dft(f, spec, cv::DFT_COMPLEX_OUTPUT);
+    return spec;
+}
+
+FftEngine::Spectra& FftEngine::spectraFor(const cv::Mat& src) {
+    auto it = std::find_if(spectra.begin(), spectra.end(),
+                           [&src](const Spectra& s) { return sameBuffer(s.source, src); });
+    if (it == spectra.end()) {
+        if (spectra.size() >= kMaxSpectra) spectra.pop_back();
+        Spectra fresh;
+        fresh.source = src;
+        spectra.insert(spectra.begin(), std::move(fresh));
+    } else if (it != spectra.begin()) {
+        std::rotate(spectra.begin(), it, it + 1);
+    }
+    return spectra.front();
+}
+
+static cv::Size paddedSize(const cv::Mat& src) {
+    return { cv::getOptimalDFTSize(src.cols), cv::getOptimalDFTSize(src.rows) };
+}
+
+cv::Mat FftEngine::magnitudeSpectrum(const cv::Mat& src) {
+    if (src.empty()) return cv::Mat();
+    Spectra& s = spectraFor(src);
+    const cv::Size padded = paddedSize(src);
+    if (s.luma.empty()) {
+        if (src.channels() == 1) {
+            if (s.channels.empty()) s.channels.push_back(forward(src, padded));
+            s.luma = s.channels[0];
+        } else {
+            cv::Mat gray;
+            cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+            s.luma = forward(gray, padded);
+        }
+    }
+
+    Scratch& w = scratch;
+    cv::split(s.luma, w.planes);
+    cv::Mat& mag = w.magnitude;
+    cv::magnitude(w.planes[0], w.planes[1], mag);
+    mag += cv::Scalar::all(1);
+    cv::log(mag, mag);
+    cv::normalize(mag, mag, 0, 255, cv::NORM_MINMAX);
+
+    // Swap quadrants while converting: one pass, two row segments per row.
+    cv::Mat& mag8 = w.magnitude8;
+    mag.convertTo(mag8, CV_8U);
+    const int cx = mag8.cols / 2, cy = mag8.rows / 2;
+    cv::Mat& shifted = w.shifted;
+    shifted.create(mag8.size(), CV_8U);
+    for (int y = 0; y < mag8.rows; ++y) {
+        const uchar* in = mag8.ptr<uchar>((y + cy) % mag8.rows);
+        uchar* out = shifted.ptr<uchar>(y);
+        std::memcpy(out, in + cx, mag8.cols - cx);
+        std::memcpy(out + (mag8.cols - cx), in, cx);
+    }
+
+    cv::Mat out = MatPool::local().acquire(src.size(), CV_8UC1);
+    if (shifted.size() != src.size()) cv::resize(shifted, out, src.size(), 0, 0, cv::INTER_AREA);
+    else shifted.copyTo(out);
+    return out;
+}
+
+const cv::Mat& FftEngine::transferFor(const FrequencyFilter& f, cv::Size padded, cv::Size image) {
+    if (!mask.empty() && maskParams == f && maskPadded == padded && maskImage == image) return mask;
+
+    auto lowPass = [&f](double d2, double r) -> double {
+        const double r2 = std::max(r * r, 1e-6);
+        switch (f.shape) {
+        case Shape::Ideal: return d2 <= r2 ? 1.0 : 0.0;
+        case Shape::Butterworth: return 1.0 / (1.0 + std::pow(d2 / r2, std::max(1, f.order)));
+        case Shape::Gaussian: return std::exp(-d2 / (2.0 * r2));
+        }
+        return 1.0;
+    };
+
+    // Index i of a padded axis is i / padded cycles per pixel, i.e.
+    // i * image / padded cycles per image; indices past the middle wrap to
+    // negative frequencies.
+    const double sx = double(image.width) / padded.width;
+    const double sy = double(image.height) / padded.height;
+    cv::Mat h(padded, CV_32F);
+    for (int y = 0; y < padded.height; ++y) {
+        const double v = (y <= padded.height / 2 ? y : y - padded.height) * sy;
+        float* row = h.ptr<float>(y);
+        for (int x = 0; x < padded.width; ++x) {
+            const double u = (x <= padded.width / 2 ? x : x - padded.width) * sx;
+            double value;
+            if (f.kind == Kind::Notch) {
+                const double d1 = (u - f.notchU) * (u - f.notchU) + (v - f.notchV) * (v - f.notchV);
+                const double d2 = (u + f.notchU) * (u + f.notchU) + (v + f.notchV) * (v + f.notchV);
+                value = (1.0 - lowPass(d1, f.notchRadius)) * (1.0 - lowPass(d2, f.notchRadius));
+            } else {
+                const double lp = lowPass(u * u + v * v, f.cutoff);
+                value = f.kind == Kind::LowPass ? lp : 1.0 - lp;
+            }
+            row[x] = float(value);
+        }
+    }
+    cv::Mat planes[] = { h, h };
+    cv::merge(planes, 2, mask);
+    maskParams = f;
+    maskPadded = padded;
+    maskImage = image;
+    return mask;
+}
+
+cv::Mat FftEngine::filter(const cv::Mat& src, const FrequencyFilter& f) {
+    if (src.empty()) return cv::Mat();
+    Spectra& s = spectraFor(src);
+    const cv::Size padded = paddedSize(src);
+    if (s.channels.empty()) {
+        std::vector<cv::Mat> planes;
+        cv::split(src, planes);
+        for (const auto& p : planes) s.channels.push_back(forward(p, padded));
+    }
+
+    const cv::Mat& h = transferFor(f, padded, src.size());
+    const double offset = f.kind == Kind::HighPass ? 128.0 : 0.0;
+    Scratch& w = scratch;
+    w.outPlanes.resize(s.channels.size());
+    for (size_t c = 0; c < s.channels.size(); ++c) {
+        cv::multiply(s.channels[c], h, w.product);
+        cv::idft(w.product, w.spatial, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+        w.spatial(cv::Rect(0, 0, src.cols, src.rows)).convertTo(w.outPlanes[c], src.depth(), 1.0, offset);
+    }
+    cv::Mat out = MatPool::local().acquire(src.size(), src.type());
+    cv::merge(w.outPlanes, out);
+    return out;
+}
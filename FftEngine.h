@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Frequency-domain processing around one cached forward transform.
+//
+// Inputs are padded (reflected) to cv::getOptimalDFTSize and transformed as
+// real data with DFT_COMPLEX_OUTPUT. The spectra of the last two source
+// buffers are kept (most recently used first), so changing a frequency
+// filter's parameters only re-runs the inverse transform, even while a
+// preview and the full-resolution refine alternate on the same engine. The
+// cache holds a reference to each source, which keeps pointer identity a
+// safe key (same rule as FilterPipeline's step cache).
+//
+// Frequencies are measured in cycles per image, so a cutoff means the same
+// thing on a downscaled preview and at full resolution.
+class FftEngine {
+public:
+    enum class Kind { LowPass, HighPass, Notch };
+    enum class Shape { Ideal, Butterworth, Gaussian };
+
+    struct FrequencyFilter {
+        Kind kind = Kind::LowPass;
+        Shape shape = Shape::Butterworth;
+        double cutoff = 30.0;   // low/high-pass radius
+        int order = 2;          // Butterworth only
+        int notchU = 20;        // notch centre; its mirror (-u, -v) is rejected too
+        int notchV = 0;
+        double notchRadius = 5.0;
+
+        bool operator==(const FrequencyFilter& o) const;
+    };
+
+    // Centred log-magnitude of the luma spectrum, CV_8UC1, resized to src's size.
+    cv::Mat magnitudeSpectrum(const cv::Mat& src);
+    // Applies the filter to every channel. High-pass output is centred on
+    // 128 so negative responses stay visible.
+    cv::Mat filter(const cv::Mat& src, const FrequencyFilter& f);
+    void clear();
+
+private:
+    struct Spectra {
+        cv::Mat source;
+        std::vector<cv::Mat> channels; // CV_32FC2, padded size
+        cv::Mat luma;
+    };
+
+    Spectra& spectraFor(const cv::Mat& src);
+    static cv::Mat forward(const cv::Mat& plane, cv::Size padded);
+    const cv::Mat& transferFor(const FrequencyFilter& f, cv::Size padded, cv::Size image);
+
+    // Intermediates reused across calls (same size → no allocation).
+    struct Scratch {
+        cv::Mat planes[2];
+        cv::Mat magnitude, magnitude8, shifted;
+        cv::Mat product, spatial;
+        std::vector<cv::Mat> outPlanes;
+    };
+
+    std::vector<Spectra> spectra;
+    Scratch scratch;
+    FrequencyFilter maskParams;
+    cv::Size maskPadded, maskImage;
+    cv::Mat mask; // CV_32FC2, both planes hold the real transfer function
+};
@@ -0,0 +1,237 @@
+#include "FilterPipeline.h"
+#include "Filters.h"
+#include "PointOps.h"
+#include "Profiler.h"
+
+// Covers Canny's gradients and non-maximum suppression exactly. Hysteresis
+// has no bounded reach, though: a weak edge is kept if it connects to a
+// strong one anywhere, so near a strip or region border it can come out
+// differently than in the whole-image result. Tiled and region Canny are
+// therefore approximate; the halo only keeps such differences rare.
+static const int kCannyHalo = 16;
+
+static bool sameBuffer(const cv::Mat& a, const cv::Mat& b) {
+    return a.data == b.data && a.size == b.size && a.type() == b.type() && a.step[0] == b.step[0];
+}
+
+void FilterPipeline::clear() {
+    cache.clear();
+    previewCache.clear();
+    regionCache.clear();
+    proxySource.release();
+    proxy.release();
+    fft.clear();
+}
+
+const cv::Mat& FilterPipeline::proxyFor(const cv::Mat& src, double scale) {
+    if (!sameBuffer(proxySource, src) || proxyScale != scale) {
+        proxySource = src;
+        proxyScale = scale;
+        cv::resize(src, proxy, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    return proxy;
+}
+
+cv::Mat FilterPipeline::run(const cv::Mat& src, const QList<FilterConfig>& stages, double scale,
+                            const CancelCheck& cancelled, double sourceScale) {
+    recomputed = 0;
+    if (src.empty()) return cv::Mat();
+
+    const bool downscaled = scale > 0.0 && scale < 1.0;
+    const cv::Mat& input = downscaled ? proxyFor(src, scale) : src;
+    const double paramScale = (downscaled ? scale : 1.0) * sourceScale;
+    if (paramScale < 1.0) return runLane(previewCache, input, stages, paramScale, cancelled);
+    return runLane(cache, input, stages, 1.0, cancelled);
+}
+
+cv::Mat FilterPipeline::runRegion(const cv::Mat& src, const cv::Rect& roi, const QList<FilterConfig>& stages,
+                                  const CancelCheck& cancelled, double sourceScale) {
+    recomputed = 0;
+    const cv::Rect bounds(0, 0, src.cols, src.rows);
+    const cv::Rect r = roi & bounds;
+    if (r.empty()) return cv::Mat();
+
+    const double paramScale = sourceScale < 1.0 ? sourceScale : 1.0;
+    int halo = 0;
+    for (const auto& st : stages) halo += haloFor(paramScale < 1.0 ? scaledForPreview(st, paramScale) : st);
+    const cv::Rect padded = cv::Rect(r.x - halo, r.y - halo, r.width + 2 * halo, r.height + 2 * halo) & bounds;
+    // The same rectangle of the same source gives the same header, so the
+    // region lane hits its cache just like the full-image one.
+    const cv::Mat out = runLane(regionCache, src(padded), stages, paramScale, cancelled);
+    if (out.empty()) return cv::Mat();
+    return out(r - padded.tl());
+}
+
+cv::Mat FilterPipeline::runLane(std::vector<CachedStep>& lane, cv::Mat cur, const QList<FilterConfig>& stages,
+                                double scale, const CancelCheck& cancelled) {
+    const bool preview = scale < 1.0;
+    QList<Step> steps;
+    for (const auto& st : stages) {
+        const FilterConfig cfg = preview ? scaledForPreview(st, scale) : st;
+        if (!steps.isEmpty() && isPointOp(cfg) && isPointOp(steps.last().last()))
+            steps.last().push_back(cfg);
+        else
+            steps.push_back(Step{ cfg });
+    }
+
+    const size_t n = static_cast<size_t>(steps.size());
+    for (size_t i = 0; i < n; ++i) {
+        const Step& step = steps[static_cast<int>(i)];
+        // The cached input keeps its buffer alive, so pointer identity is a
+        // reliable key: a different upstream result can never alias it.
+        if (i < lane.size() && sameBuffer(lane[i].input, cur) && sameStep(lane[i].cfgs, step)) {
+            cur = lane[i].output;
+            continue;
+        }
+        if (cancelled && cancelled()) return cv::Mat();
+
+        cv::Mat out = applyStep(cur, step, &fft);
+        recomputed += int(step.size());
+        if (i < lane.size()) lane[i] = { cur, step, out };
+        else lane.push_back({ cur, step, out });
+        cur = out;
+    }
+    lane.resize(n);
+    return cur;
+}
+
+cv::Mat FilterPipeline::applyStep(const cv::Mat& src, const Step& step, FftEngine* fft) {
+    if (step.size() == 1) return applyStage(src, step.first(), fft);
+    IMAGELAB_TRACE_SCOPE("PointOpChain (fundido)");
+    PointOpChain chain;
+    for (const auto& cfg : step) appendPointOp(chain, cfg);
+    return chain.apply(src);
+}
+
+bool FilterPipeline::sameStep(const Step& a, const Step& b) {
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); ++i)
+        if (!sameParameters(a[i], b[i])) return false;
+    return true;
+}
+
+bool FilterPipeline::isPointOp(const FilterConfig& cfg) {
+    return cfg.name == "Brilho/Contraste" || cfg.name == "Gama"
+        || cfg.name == "Inverter" || cfg.name == "Limiar";
+}
+
+void FilterPipeline::appendPointOp(PointOpChain& chain, const FilterConfig& cfg) {
+    if (cfg.name == "Brilho/Contraste") chain.brightnessContrast(cfg.brightness, cfg.contrast);
+    else if (cfg.name == "Gama") chain.gamma(cfg.gamma);
+    else if (cfg.name == "Inverter") chain.invert();
+    else if (cfg.name == "Limiar") chain.threshold(cfg.threshold);
+}
+
+bool FilterPipeline::supportsRegion(const QList<FilterConfig>& stages) {
+    for (const auto& st : stages)
+        if (isFrequencyDomain(st) || st.name == "Equalização de Histograma") return false;
+    return true;
+}
+
+int FilterPipeline::haloFor(const FilterConfig& cfg) {
+    if (cfg.name == "Desfoque Gaussiano") return Filters::gaussianSupportRadius(cfg.ksize, cfg.sigma);
+    if (cfg.name == "Canny") return kCannyHalo;
+    return 0;
+}
+
+bool FilterPipeline::isFrequencyDomain(const FilterConfig& cfg) {
+    return cfg.name == "Espectro (FFT)" || cfg.name == "Passa-Baixa (FFT)"
+        || cfg.name == "Passa-Alta (FFT)" || cfg.name == "Notch (FFT)";
+}
+
+FftEngine::FrequencyFilter FilterPipeline::frequencyFilterFor(const FilterConfig& cfg) {
+    FftEngine::FrequencyFilter f;
+    if (cfg.name == "Passa-Alta (FFT)") f.kind = FftEngine::Kind::HighPass;
+    else if (cfg.name == "Notch (FFT)") f.kind = FftEngine::Kind::Notch;
+    if (cfg.freqShape == "Ideal") f.shape = FftEngine::Shape::Ideal;
+    else if (cfg.freqShape == "Gaussiano") f.shape = FftEngine::Shape::Gaussian;
+    f.cutoff = cfg.cutoff;
+    f.order = cfg.order;
+    f.notchU = cfg.notchU;
+    f.notchV = cfg.notchV;
+    f.notchRadius = cfg.notchRadius;
+    return f;
+}
+
+cv::Mat FilterPipeline::applyStage(const cv::Mat& src, const FilterConfig& cfg, FftEngine* fft) {
+    if (src.empty()) return cv::Mat();
+    IMAGELAB_TRACE_SCOPE(cfg.name);
+
+    if (cfg.name == "Escala de Cinza") {
+        return Filters::toGrayscale(src);
+    } else if (cfg.name == "Equalização de Histograma") {
+        return Filters::equalizeHistColor(src);
+    } else if (cfg.name == "Desfoque Gaussiano") {
+        return Filters::gaussianBlur(src, cfg.ksize, cfg.sigma);
+    } else if (cfg.name == "Canny") {
+        return Filters::canny(src, cfg.lowThresh, cfg.highThresh);
+    } else if (cfg.name == "Brilho/Contraste") {
+        return Filters::brightnessContrast(src, cfg.brightness, cfg.contrast);
+    } else if (cfg.name == "Gama") {
+        return Filters::gammaCorrection(src, cfg.gamma);
+    } else if (cfg.name == "Inverter") {
+        return Filters::invert(src);
+    } else if (cfg.name == "Limiar") {
+        return Filters::threshold(src, cfg.threshold);
+    } else if (isFrequencyDomain(cfg)) {
+        FftEngine local;
+        FftEngine& engine = fft ? *fft : local;
+        if (cfg.name == "Espectro (FFT)") return engine.magnitudeSpectrum(src);
+        return engine.filter(src, frequencyFilterFor(cfg));
+    }
+    return src;
+}
+
+FilterConfig FilterPipeline::scaledForPreview(const FilterConfig& cfg, double scale) {
+    FilterConfig out = cfg;
+    if (cfg.name == "Desfoque Gaussiano") {
+        out.ksize = qMax(1, qRound(cfg.ksize * scale)) | 1;
+        out.sigma = qMax(0.1, cfg.sigma * scale);
+    }
+    return out;
+}
+
+FilterConfig FilterPipeline::canonical(const FilterConfig& cfg) {
+    FilterConfig out;
+    out.name = cfg.name;
+    if (cfg.name == "Desfoque Gaussiano") {
+        out.ksize = cfg.ksize;
+        out.sigma = cfg.sigma;
+    } else if (cfg.name == "Canny") {
+        out.lowThresh = cfg.lowThresh;
+        out.highThresh = cfg.highThresh;
+    } else if (cfg.name == "Brilho/Contraste") {
+        out.brightness = cfg.brightness;
+        out.contrast = cfg.contrast;
+    } else if (cfg.name == "Gama") {
+        out.gamma = cfg.gamma;
+    } else if (cfg.name == "Limiar") {
+        out.threshold = cfg.threshold;
+    } else if (cfg.name == "Passa-Baixa (FFT)" || cfg.name == "Passa-Alta (FFT)") {
+        out.freqShape = cfg.freqShape;
+        out.cutoff = cfg.cutoff;
+        if (cfg.freqShape == "Butterworth") out.order = cfg.order;
+    } else if (cfg.name == "Notch (FFT)") {
+        out.freqShape = cfg.freqShape;
+        out.notchU = cfg.notchU;
+        out.notchV = cfg.notchV;
+        out.notchRadius = cfg.notchRadius;
+        if (cfg.freqShape == "Butterworth") out.order = cfg.order;
+    }
+    return out;
+}
+
+bool FilterPipeline::sameParameters(const FilterConfig& a, const FilterConfig& b) {
+    if (a.name != b.name) return false;
+    if (a.name == "Desfoque Gaussiano") return a.ksize == b.ksize && a.sigma == b.sigma;
+    if (a.name == "Canny") return a.lowThresh == b.lowThresh && a.highThresh == b.highThresh;
+    if (a.name == "Brilho/Contraste") return a.brightness == b.brightness && a.contrast == b.contrast;
+    if (a.name == "Gama") return a.gamma == b.gamma;
+    if (a.name == "Limiar") return a.threshold == b.threshold;
+    if (isFrequencyDomain(a)) {
+        const FilterConfig ca = canonical(a), cb = canonical(b);
+        return ca.freqShape == cb.freqShape && ca.cutoff == cb.cutoff && ca.order == cb.order
+            && ca.notchU == cb.notchU && ca.notchV == cb.notchV && ca.notchRadius == cb.notchRadius;
+    }
+    return true;
+}
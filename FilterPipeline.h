@@ -0,0 +1,93 @@
+#pragma once
+#include <QList>
+#include <functional>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "FftEngine.h"
+#include "SessionStore.h"
+
+class PointOpChain;
+
+// Ordered chain of filter stages. The output of every stage is cached
+// together with the input it was computed from, so editing stage N only
+// re-runs stages N..end on the next call.
+//
+// Runs of consecutive point operations (brightness/contrast, gamma, invert,
+// threshold) are fused into one lookup table and cached as a single step.
+//
+// With scale < 1 the chain runs on a downscaled proxy of `src` with
+// spatial parameters scaled to match; preview and full-resolution runs keep
+// separate caches so alternating between them does not evict either.
+// Parameters are tuned for the full-resolution image: when `src` is itself
+// reduced (sourceScale < 1, e.g. a reduced JPEG decode) they are scaled by
+// scale * sourceScale, and only a product of 1 counts as full resolution.
+//
+// Frequency-domain stages share one FftEngine, so retuning a low/high-pass
+// or notch filter reuses the forward spectrum of its (cached) input.
+//
+// runRegion() renders one rectangle of the image, reading only the halo the
+// stages need around it; it has a cache lane of its own as well. Canny is
+// the exception to an exact match: its hysteresis can differ near the
+// region's border (see haloFor).
+class FilterPipeline {
+public:
+    using CancelCheck = std::function<bool()>;
+
+    // Returns an empty Mat if `cancelled` reports true between stages.
+    cv::Mat run(const cv::Mat& src, const QList<FilterConfig>& stages, double scale = 1.0,
+                const CancelCheck& cancelled = CancelCheck(), double sourceScale = 1.0);
+    // Returns `roi` of the full-resolution result. Only valid when
+    // supportsRegion(stages); otherwise the rectangle's edges would differ.
+    cv::Mat runRegion(const cv::Mat& src, const cv::Rect& roi, const QList<FilterConfig>& stages,
+                      const CancelCheck& cancelled = CancelCheck(), double sourceScale = 1.0);
+    void clear();
+
+    int lastRecomputedStages() const { return recomputed; }
+
+    // Without an engine, frequency-domain stages transform from scratch.
+    static cv::Mat applyStage(const cv::Mat& src, const FilterConfig& cfg, FftEngine* fft = nullptr);
+    static bool sameParameters(const FilterConfig& a, const FilterConfig& b);
+    // Copy of `cfg` with the fields its filter ignores reset to defaults.
+    static FilterConfig canonical(const FilterConfig& cfg);
+    static FilterConfig scaledForPreview(const FilterConfig& cfg, double scale);
+
+    static bool isPointOp(const FilterConfig& cfg);
+    static void appendPointOp(PointOpChain& chain, const FilterConfig& cfg);
+
+    // Stages that need the whole image (spectrum, low/high-pass, notch).
+    static bool isFrequencyDomain(const FilterConfig& cfg);
+    static FftEngine::FrequencyFilter frequencyFilterFor(const FilterConfig& cfg);
+
+    // Stages whose output pixels depend on a bounded neighbourhood, so a
+    // rectangle can be rendered on its own. Frequency-domain filters and
+    // global histogram equalization opt out.
+    static bool supportsRegion(const QList<FilterConfig>& stages);
+    // Pixels a stage reads around each output pixel. For Canny this covers
+    // the gradients only; hysteresis is unbounded, so strips are approximate.
+    static int haloFor(const FilterConfig& cfg);
+
+private:
+    using Step = QList<FilterConfig>;
+
+    struct CachedStep {
+        cv::Mat input;
+        Step cfgs;
+        cv::Mat output;
+    };
+
+    cv::Mat runLane(std::vector<CachedStep>& lane, cv::Mat cur, const QList<FilterConfig>& stages,
+                    double scale, const CancelCheck& cancelled);
+    static cv::Mat applyStep(const cv::Mat& src, const Step& step, FftEngine* fft);
+    static bool sameStep(const Step& a, const Step& b);
+    const cv::Mat& proxyFor(const cv::Mat& src, double scale);
+
+    std::vector<CachedStep> cache;
+    std::vector<CachedStep> previewCache;
+    std::vector<CachedStep> regionCache;
+    cv::Mat proxySource;
+    cv::Mat proxy;
+    double proxyScale = 1.0;
+    FftEngine fft;
+    int recomputed = 0;
+};
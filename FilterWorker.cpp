@@ -0,0 +1,67 @@
+#include "FilterWorker.h"
+#include "MatPool.h"
+#include "Profiler.h"
+
+#include <QMutexLocker>
+
+// Buffers the worker thread may keep for reuse between renders.
+static const std::size_t kPoolBytes = std::size_t(256) << 20;
+
+FilterWorker::FilterWorker(QObject* parent) : QObject(parent) {
+    qRegisterMetaType<cv::Mat>("cv::Mat");
+    qRegisterMetaType<cv::Rect>("cv::Rect");
+}
+
+quint64 FilterWorker::submit(const cv::Mat& src, const QList<FilterConfig>& stages, double scale,
+                             const cv::Rect& region, double sourceScale) {
+    QMutexLocker lock(&mutex);
+    const quint64 id = ++latest;
+    pending = { id, src, stages, scale, region, sourceScale };
+    hasPending = true;
+    if (!scheduled) {
+        scheduled = true;
+        QMetaObject::invokeMethod(this, [this]{ processPending(); }, Qt::QueuedConnection);
+    }
+    return id;
+}
+
+void FilterWorker::cancelAll() {
+    QMutexLocker lock(&mutex);
+    ++latest;
+    pending = Request();
+    hasPending = false;
+}
+
+void FilterWorker::processPending() {
+    MatPool& pool = MatPool::local();
+    pool.enable(kPoolBytes);
+    for (;;) {
+        Request req;
+        {
+            QMutexLocker lock(&mutex);
+            if (!hasPending) {
+                scheduled = false;
+                return;
+            }
+            req = std::move(pending);
+            pending = Request();
+            hasPending = false;
+        }
+        if (!isCurrent(req.id)) continue;
+
+        const quint64 id = req.id;
+        const auto cancelled = [this, id]{ return !isCurrent(id); };
+        cv::Mat out;
+        if (!req.region.empty()) {
+            IMAGELAB_TRACE_SCOPE("FilterPipeline::runRegion");
+            out = pipeline.runRegion(req.src, req.region, req.stages, cancelled, req.sourceScale);
+        } else {
+            IMAGELAB_TRACE_SCOPE(req.scale < 1.0 ? "FilterPipeline::run (prévia)" : "FilterPipeline::run");
+            out = pipeline.run(req.src, req.stages, req.scale, cancelled, req.sourceScale);
+        }
+        pool.trim();
+
+        if (out.empty() || !isCurrent(id)) continue;
+        emit finished(req.id, out, req.scale, req.region);
+    }
+}
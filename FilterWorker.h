@@ -0,0 +1,53 @@
+#pragma once
+#include <QObject>
+#include <QMutex>
+#include <atomic>
+#include <opencv2/opencv.hpp>
+
+#include "FilterPipeline.h"
+
+Q_DECLARE_METATYPE(cv::Mat)
+Q_DECLARE_METATYPE(cv::Rect)
+
+// Runs filters on a background thread. Only the newest request matters:
+// submitting replaces any request that has not started yet, and results
+// of superseded requests are dropped instead of being emitted.
+class FilterWorker : public QObject {
+    Q_OBJECT
+public:
+    explicit FilterWorker(QObject* parent = nullptr);
+
+    // scale < 1 renders a downscaled preview (see FilterPipeline::run). A
+    // non-empty `region` renders only that rectangle at full resolution
+    // (FilterPipeline::runRegion); the result then covers just the region.
+    // `sourceScale` is the size of `src` relative to the full resolution.
+    quint64 submit(const cv::Mat& src, const QList<FilterConfig>& stages, double scale = 1.0,
+                   const cv::Rect& region = cv::Rect(), double sourceScale = 1.0);
+    void cancelAll();
+    quint64 latestRequest() const { return latest.load(); }
+
+signals:
+    void finished(quint64 requestId, const cv::Mat& result, double scale, const cv::Rect& region);
+
+private:
+    struct Request {
+        quint64 id = 0;
+        cv::Mat src;
+        QList<FilterConfig> stages;
+        double scale = 1.0;
+        cv::Rect region;
+        double sourceScale = 1.0;
+    };
+
+    void processPending();
+    bool isCurrent(quint64 id) const { return id == latest.load(); }
+
+    QMutex mutex;
+    Request pending;
+    bool hasPending = false;
+    bool scheduled = false;
+    std::atomic<quint64> latest { 0 };
+
+    // Only touched from the worker thread.
+    FilterPipeline pipeline;
+};
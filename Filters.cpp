@@ -1,91 +1,233 @@
 #include "Filters.h"
+#include "FftEngine.h"
+#include "FixedGaussian.h"
+#include "MatPool.h"
+#include "PointOps.h"
+#include "Profiler.h"
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Kernels at least this wide go through the recursive implementation.
+const int kRecursiveGaussianMinKsize = 31;
+const double kRecursiveGaussianMinSigma = 2.0;
+// Columns per task in the vertical recursive pass.
+const int kRecursiveColumnBlock = 256;
+
+double effectiveSigma(int ksize, double sigma) {
+    return sigma > 0 ? sigma : 0.3 * ((ksize - 1) * 0.5 - 1) + 0.8;
+}
+
+// Taps beyond 4 sigma weigh less than 3.4e-4 of the centre tap.
+int effectiveKsize(int ksize, double sigma) {
+    if (ksize % 2 == 0) ksize += 1;
+    return std::min(ksize, 2 * int(std::ceil(4.0 * effectiveSigma(ksize, sigma))) + 1);
+}
+
+struct YvvCoeffs {
+    float B, b1, b2, b3;
+};
+
+// Young & van Vliet, "Recursive implementation of the Gaussian filter"
+// (1995), with the feedback coefficients pre-divided by b0.
+YvvCoeffs yvvCoefficients(double sigma) {
+    const double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                                  : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    const double q2 = q * q, q3 = q2 * q;
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    const double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    const double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    const double b3 = 0.422205 * q3;
+    return { float(1.0 - (b1 + b2 + b3) / b0), float(b1 / b0), float(b2 / b0), float(b3 / b0) };
+}
+
+// Causal then anti-causal pass along one line, in place. Boundaries start
+// from the steady state of a replicated edge pixel.
+void yvvLine(float* p, int n, int stride, const YvvCoeffs& k) {
+    float w1 = p[0], w2 = w1, w3 = w1;
+    for (int i = 0; i < n; ++i) {
+        const float w = k.B * p[i * stride] + k.b1 * w1 + k.b2 * w2 + k.b3 * w3;
+        w3 = w2; w2 = w1; w1 = w;
+        p[i * stride] = w;
+    }
+    w1 = p[(n - 1) * stride]; w2 = w1; w3 = w1;
+    for (int i = n - 1; i >= 0; --i) {
+        const float w = k.B * p[i * stride] + k.b1 * w1 + k.b2 * w2 + k.b3 * w3;
+        w3 = w2; w2 = w1; w1 = w;
+        p[i * stride] = w;
+    }
+}
+
+// Same recursion down a block of columns, processed row by row so every
+// step is a contiguous, vectorizable loop over the block.
+void yvvColumns(cv::Mat& buf, int j0, int j1, const YvvCoeffs& k) {
+    const int w = j1 - j0;
+    std::vector<float> s1(w), s2(w), s3(w);
+    auto run = [&](int yFirst, int yLast, int dy) {
+        const float* edge = buf.ptr<float>(yFirst) + j0;
+        std::copy(edge, edge + w, s1.begin());
+        s2 = s1;
+        s3 = s1;
+        for (int y = yFirst;; y += dy) {
+            float* row = buf.ptr<float>(y) + j0;
+            for (int i = 0; i < w; ++i) {
+                const float v = k.B * row[i] + k.b1 * s1[i] + k.b2 * s2[i] + k.b3 * s3[i];
+                s3[i] = s2[i]; s2[i] = s1[i]; s1[i] = v;
+                row[i] = v;
+            }
+            if (y == yLast) break;
+        }
+    };
+    run(0, buf.rows - 1, 1);
+    run(buf.rows - 1, 0, -1);
+}
+
+} // namespace
 
 namespace Filters {
 
 cv::Mat toGrayscale(const cv::Mat& src) {
-    cv::Mat gray;
-    if (src.channels() == 1) return src.clone();
-    cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
-    cv::cvtColor(gray, gray, cv::COLOR_GRAY2BGR);
-    return gray;
+    // Results are never modified in place; no need to copy.
+    if (src.channels() == 1) return src;
+    cv::Mat out = MatPool::local().acquire(src.size(), CV_MAKETYPE(src.depth(), 1));
+    cv::cvtColor(src, out, cv::COLOR_BGR2GRAY);
+    return out;
 }
 
 cv::Mat equalizeHistColor(const cv::Mat& src) {
-    cv::Mat ycrcb;
+    if (src.channels() == 1) {
+        cv::Mat out = MatPool::local().acquire(src.size(), src.type());
+        cv::equalizeHist(src, out);
+        return out;
+    }
+    // Scratch comes from MatPool too, so its cap and trim() cover it.
+    MatPool& pool = MatPool::local();
+    cv::Mat ycrcb = pool.acquire(src.size(), CV_MAKETYPE(src.depth(), 3));
     cv::cvtColor(src, ycrcb, cv::COLOR_BGR2YCrCb);
-    std::vector<cv::Mat> ch;
-    cv::split(ycrcb, ch);
-    cv::equalizeHist(ch[0], ch[0]);
-    cv::merge(ch, ycrcb);
-    cv::Mat out;
+    cv::Mat planes[3];
+    for (cv::Mat& p : planes) p = pool.acquire(src.size(), CV_MAKETYPE(src.depth(), 1));
+    cv::split(ycrcb, planes);
+    cv::equalizeHist(planes[0], planes[0]);
+    cv::merge(planes, 3, ycrcb);
+    cv::Mat out = pool.acquire(src.size(), src.type());
     cv::cvtColor(ycrcb, out, cv::COLOR_YCrCb2BGR);
     return out;
 }
 
 cv::Mat gaussianBlur(const cv::Mat& src, int ksize, double sigma) {
     if (ksize % 2 == 0) ksize += 1;
+    sigma = effectiveSigma(ksize, sigma);
+    ksize = effectiveKsize(ksize, sigma);
+    // The recursive filter approximates the untruncated Gaussian, so it only
+    // replaces kernels that already span +-3 sigma.
+    if (ksize >= kRecursiveGaussianMinKsize && sigma >= kRecursiveGaussianMinSigma
+            && ksize >= 2 * int(std::ceil(3.0 * sigma)) + 1) {
+        return gaussianBlurRecursive(src, sigma);
+    }
     cv::Mat out;
+    if (FixedGaussian::blur(src, out, ksize, sigma)) return out;
+    out = MatPool::local().acquire(src.size(), src.type());
     cv::GaussianBlur(src, out, cv::Size(ksize, ksize), sigma);
     return out;
 }
 
+cv::Mat gaussianBlurRecursive(const cv::Mat& src, double sigma) {
+    if (src.empty()) return cv::Mat();
+    if (sigma < 0.5) {
+        cv::Mat out;
+        cv::GaussianBlur(src, out, cv::Size(0, 0), std::max(sigma, 0.1));
+        return out;
+    }
+
+    const YvvCoeffs k = yvvCoefficients(sigma);
+    const int cn = src.channels();
+    cv::Mat buf = MatPool::local().acquire(src.size(), CV_MAKETYPE(CV_32F, cn));
+    src.convertTo(buf, CV_MAKETYPE(CV_32F, cn));
+
+    cv::parallel_for_(cv::Range(0, buf.rows), [&](const cv::Range& r) {
+        for (int y = r.start; y < r.end; ++y) {
+            float* row = buf.ptr<float>(y);
+            for (int c = 0; c < cn; ++c) yvvLine(row + c, buf.cols, cn, k);
+        }
+    });
+
+    const int width = buf.cols * cn;
+    const int blocks = (width + kRecursiveColumnBlock - 1) / kRecursiveColumnBlock;
+    cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range& r) {
+        for (int b = r.start; b < r.end; ++b) {
+            const int j0 = b * kRecursiveColumnBlock;
+            yvvColumns(buf, j0, std::min(width, j0 + kRecursiveColumnBlock), k);
+        }
+    });
+
+    cv::Mat out = MatPool::local().acquire(src.size(), src.type());
+    buf.convertTo(out, src.type());
+    return out;
+}
+
+int gaussianSupportRadius(int ksize, double sigma) {
+    if (ksize % 2 == 0) ksize += 1;
+    sigma = effectiveSigma(ksize, sigma);
+    const int k = effectiveKsize(ksize, sigma);
+    // The recursive path has infinite support; 4 sigma covers it in practice.
+    if (k >= kRecursiveGaussianMinKsize) return std::max(k / 2, int(std::ceil(4.0 * sigma)));
+    return k / 2;
+}
+
 cv::Mat canny(const cv::Mat& src, int low, int high) {
-    cv::Mat gray, edges, out;
+    cv::Mat gray = src;
+    if (src.channels() == 3) {
+        gray = MatPool::local().acquire(src.size(), CV_8UC1);
+        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+    }
+    cv::Mat out = MatPool::local().acquire(src.size(), CV_8UC1);
+    cv::Canny(gray, out, low, high);
+    return out;
+}
+
+void cannyGradients(const cv::Mat& src, cv::Mat& dx, cv::Mat& dy) {
+    cv::Mat gray = src;
     if (src.channels() == 3) cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
-    else gray = src;
-    cv::Canny(gray, edges, low, high);
-    cv::cvtColor(edges, out, cv::COLOR_GRAY2BGR);
+    // What cv::Canny computes internally for aperture 3.
+    cv::Sobel(gray, dx, CV_16S, 1, 0, 3, 1, 0, cv::BORDER_REPLICATE);
+    cv::Sobel(gray, dy, CV_16S, 0, 1, 3, 1, 0, cv::BORDER_REPLICATE);
+}
+
+cv::Mat cannyFromGradients(const cv::Mat& dx, const cv::Mat& dy, int low, int high) {
+    cv::Mat out = MatPool::local().acquire(dx.size(), CV_8UC1);
+    cv::Canny(dx, dy, out, low, high);
     return out;
 }
 
 cv::Mat brightnessContrast(const cv::Mat& src, int brightness, double contrast) {
+    if (src.depth() == CV_8U) return PointOpChain().brightnessContrast(brightness, contrast).apply(src);
     cv::Mat out;
     src.convertTo(out, -1, contrast, brightness);
     return out;
 }
 
-cv::Mat fftMagnitudeSpectrum(const cv::Mat& src) {
-    cv::Mat gray;
-    if (src.channels() == 3) cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
-    else gray = src.clone();
-
-    cv::Mat floatImg;
-    gray.convertTo(floatImg, CV_32F);
-    cv::Mat planes[] = { floatImg, cv::Mat::zeros(floatImg.size(), CV_32F) };
-    cv::Mat complexI;
-    cv::merge(planes, 2, complexI);
-
-    cv::dft(complexI, complexI);
-    cv::split(complexI, planes);
-    cv::magnitude(planes[0], planes[1], planes[0]);
-    cv::Mat mag = planes[0];
-
-    mag += cv::Scalar::all(1);
-    cv::log(mag, mag);
-
-    mag = mag(cv::Rect(0, 0, mag.cols & -2, mag.rows & -2));
-    int cx = mag.cols/2;
-    int cy = mag.rows/2;
+cv::Mat gammaCorrection(const cv::Mat& src, double gamma) {
+    return PointOpChain().gamma(gamma).apply(src);
+}
 
-    cv::Mat q0(mag, cv::Rect(0, 0, cx, cy));
-    cv::Mat q1(mag, cv::Rect(cx, 0, cx, cy));
-    cv::Mat q2(mag, cv::Rect(0, cy, cx, cy));
-    cv::Mat q3(mag, cv::Rect(cx, cy, cx, cy));
+cv::Mat invert(const cv::Mat& src) {
+    return PointOpChain().invert().apply(src);
+}
 
-    cv::Mat tmp;
-    q0.copyTo(tmp); q3.copyTo(q0); tmp.copyTo(q3);
-    q1.copyTo(tmp); q2.copyTo(q1); tmp.copyTo(q2);
+cv::Mat threshold(const cv::Mat& src, int thresh) {
+    return PointOpChain().threshold(thresh).apply(src);
+}
 
-    cv::normalize(mag, mag, 0, 255, cv::NORM_MINMAX);
-    mag.convertTo(mag, CV_8U);
-    cv::Mat out;
-    cv::cvtColor(mag, out, cv::COLOR_GRAY2BGR);
-    return out;
+cv::Mat fftMagnitudeSpectrum(const cv::Mat& src) {
+    return FftEngine().magnitudeSpectrum(src);
 }
 
 QImage matToQImage(const cv::Mat& mat) {
+    IMAGELAB_TRACE_SCOPE("Filters::matToQImage");
     if (mat.type() == CV_8UC3) {
         QImage img(mat.data, mat.cols, mat.rows, mat.step, QImage::Format_BGR888);
         return img.copy();
@@ -102,6 +244,19 @@ QImage matToQImage(const cv::Mat& mat) {
     return img.copy();
 }
 
+QImage matToQImageShared(const cv::Mat& mat) {
+    QImage::Format fmt;
+    switch (mat.type()) {
+    case CV_8UC3: fmt = QImage::Format_BGR888; break;
+    case CV_8UC1: fmt = QImage::Format_Grayscale8; break;
+    case CV_8UC4: fmt = QImage::Format_ARGB32; break;
+    default: return matToQImage(mat);
+    }
+    auto* keep = new cv::Mat(mat);
+    return QImage(static_cast<const uchar*>(keep->data), keep->cols, keep->rows, keep->step, fmt,
+                  [](void* p) { delete static_cast<cv::Mat*>(p); }, keep);
+}
+
 cv::Mat qImageToMat(const QImage& img) {
     QImage conv = img.convertToFormat(QImage::Format_RGBA8888);
     cv::Mat mat(conv.height(), conv.width(), CV_8UC4, const_cast<uchar*>(conv.bits()), conv.bytesPerLine());
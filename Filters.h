@@ -4,15 +4,34 @@
 
 namespace Filters {
 
+// Results keep their native channel count: toGrayscale, canny and
+// fftMagnitudeSpectrum return CV_8UC1, and every filter accepts 1-channel
+// input. Expansion to colour only happens where Qt needs it.
 cv::Mat toGrayscale(const cv::Mat& src);
 cv::Mat equalizeHistColor(const cv::Mat& src);
 cv::Mat gaussianBlur(const cv::Mat& src, int ksize, double sigma);
+// Young-van Vliet recursive Gaussian: cost per pixel does not depend on
+// sigma. Accurate for sigma >= 2; gaussianBlur switches to it for wide kernels.
+cv::Mat gaussianBlurRecursive(const cv::Mat& src, double sigma);
+// Radius in pixels that gaussianBlur(ksize, sigma) actually reads around a pixel.
+int gaussianSupportRadius(int ksize, double sigma);
 cv::Mat canny(const cv::Mat& src, int low, int high);
+// canny() split in two: the 3x3 Sobel gradients of the luma (CV_16S), then
+// hysteresis on them. Sweeping thresholds computes the gradients once.
+void cannyGradients(const cv::Mat& src, cv::Mat& dx, cv::Mat& dy);
+cv::Mat cannyFromGradients(const cv::Mat& dx, const cv::Mat& dy, int low, int high);
 cv::Mat brightnessContrast(const cv::Mat& src, int brightness, double contrast);
+cv::Mat gammaCorrection(const cv::Mat& src, double gamma);
+cv::Mat invert(const cv::Mat& src);
+cv::Mat threshold(const cv::Mat& src, int thresh);
 cv::Mat fftMagnitudeSpectrum(const cv::Mat& src);
 
 // Qt <-> OpenCV
 QImage matToQImage(const cv::Mat& mat);
+// Wraps the Mat's pixels without copying; the QImage keeps a reference to
+// the buffer until it is destroyed. Falls back to matToQImage for types Qt
+// cannot display directly.
+QImage matToQImageShared(const cv::Mat& mat);
 cv::Mat qImageToMat(const QImage& img);
 
 }
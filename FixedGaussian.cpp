@@ -0,0 +1,128 @@
+#include "FixedGaussian.h"
+#include "MatPool.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Rows per parallel stripe. Each stripe refilters 2 * radius rows of its
+// neighbours, so this keeps that overhead small.
+const int kStripeRows = 64;
+
+template <int K>
+struct Weights {
+    std::array<uint16_t, K> h; // Q8
+    std::array<uint16_t, K> v; // Q16
+};
+
+// Quantizes a symmetric kernel, rounding the side taps and giving the
+// remainder to the centre so the sum stays exact and symmetry is kept.
+template <int K>
+bool quantize(const cv::Mat& kernel, int one, std::array<uint16_t, K>& out) {
+    int sum = 0;
+    for (int i = 0; i < K; ++i) {
+        if (i == K / 2) continue;
+        const int w = int(std::lround(kernel.at<double>(i) * one));
+        if (w < 0 || w > 65535) return false;
+        out[i] = uint16_t(w);
+        sum += w;
+    }
+    const int centre = one - sum;
+    if (centre < 0 || centre > 65535) return false;
+    out[K / 2] = uint16_t(centre);
+    return true;
+}
+
+inline int reflect101(int i, int n) {
+    if (i < 0) return -i;
+    if (i >= n) return 2 * n - 2 - i;
+    return i;
+}
+
+template <int K, int CN>
+void horizontal(const uchar* src, uchar* padded, uint16_t* dst, int cols,
+                const std::array<uint16_t, K>& w) {
+    constexpr int R = K / 2;
+    for (int x = -R; x < cols + R; ++x) {
+        const uchar* s = src + reflect101(x, cols) * CN;
+        uchar* d = padded + (x + R) * CN;
+        for (int c = 0; c < CN; ++c) d[c] = s[c];
+    }
+    const int n = cols * CN;
+    for (int i = 0; i < n; ++i) {
+        uint16_t acc = 0;
+        for (int t = 0; t < K; ++t) acc = uint16_t(acc + w[t] * padded[i + t * CN]);
+        dst[i] = acc;
+    }
+}
+
+template <int K>
+void vertical(const std::array<const uint16_t*, K>& rows, uchar* dst, int n,
+              const std::array<uint16_t, K>& w) {
+    for (int i = 0; i < n; ++i) {
+        uint16_t acc = 128;
+        for (int t = 0; t < K; ++t)
+            acc = uint16_t(acc + uint16_t((uint32_t(rows[t][i]) * w[t]) >> 16));
+        dst[i] = uchar(acc >> 8);
+    }
+}
+
+template <int K, int CN>
+void blurStripes(const cv::Mat& src, cv::Mat& dst, const Weights<K>& w) {
+    constexpr int R = K / 2;
+    const int rows = src.rows, cols = src.cols, n = cols * CN;
+    const int stripes = (rows + kStripeRows - 1) / kStripeRows;
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        std::vector<uchar> padded(size_t(cols + 2 * R) * CN);
+        // Ring of horizontally filtered rows, slot = virtual row mod K.
+        std::vector<uint16_t> ring(size_t(K) * n);
+        auto slot = [&](int v) { return ring.data() + size_t(((v % K) + K) % K) * n; };
+        auto fill = [&](int v) {
+            horizontal<K, CN>(src.ptr<uchar>(reflect101(v, rows)), padded.data(), slot(v), cols, w.h);
+        };
+
+        for (int s = range.start; s < range.end; ++s) {
+            const int y0 = s * kStripeRows, y1 = std::min(rows, y0 + kStripeRows);
+            for (int v = y0 - R; v < y0 + R; ++v) fill(v);
+            for (int y = y0; y < y1; ++y) {
+                fill(y + R);
+                std::array<const uint16_t*, K> taps;
+                for (int t = 0; t < K; ++t) taps[t] = slot(y - R + t);
+                vertical<K>(taps, dst.ptr<uchar>(y), n, w.v);
+            }
+        }
+    });
+}
+
+template <int K>
+bool blurK(const cv::Mat& src, cv::Mat& dst, double sigma) {
+    const cv::Mat kernel = cv::getGaussianKernel(K, sigma, CV_64F);
+    Weights<K> w;
+    if (!quantize<K>(kernel, 256, w.h) || !quantize<K>(kernel, 65536, w.v)) return false;
+
+    cv::Mat out = MatPool::local().acquire(src.size(), src.type());
+    if (src.channels() == 1) blurStripes<K, 1>(src, out, w);
+    else blurStripes<K, 3>(src, out, w);
+    dst = out;
+    return true;
+}
+
+} // namespace
+
+namespace FixedGaussian {
+
+bool blur(const cv::Mat& src, cv::Mat& dst, int ksize, double sigma) {
+    if (src.depth() != CV_8U || (src.channels() != 1 && src.channels() != 3)) return false;
+    if (src.rows <= ksize / 2 || src.cols <= ksize / 2) return false;
+    switch (ksize) {
+    case 3: return blurK<3>(src, dst, sigma);
+    case 5: return blurK<5>(src, dst, sigma);
+    case 7: return blurK<7>(src, dst, sigma);
+    default: return false;
+    }
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+// Gaussian blur for the small kernels used on every ingested image (ksize 3,
+// 5 and 7 on 8-bit, 1- or 3-channel input). Kernel width and channel count
+// are template parameters, so the inner loops are fully unrolled and run in
+// 16-bit lanes:
+//   horizontal: Q8 weights (sum 256), uchar * weight accumulated in uint16;
+//   vertical:   Q16 weights (sum 65536), high half of the 16x16 product
+//               accumulated in uint16, then (acc + 128) >> 8.
+// Borders follow BORDER_REFLECT_101 like cv::GaussianBlur. Results match
+// OpenCV to within one gray level.
+namespace FixedGaussian {
+
+// Returns false, leaving dst untouched, when the input or kernel is outside
+// the fast path (other depths/channel counts, other sizes, a Q16 weight that
+// does not fit in 16 bits, images smaller than the kernel radius).
+bool blur(const cv::Mat& src, cv::Mat& dst, int ksize, double sigma);
+
+}
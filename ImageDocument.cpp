@@ -1,14 +1,137 @@
 #include "ImageDocument.h"
+#include "DecodedCache.h"
+#include "Profiler.h"
+#include <QImageReader>
+#include <QThreadPool>
 #include <opencv2/imgcodecs.hpp>
+#include <atomic>
+#include <cstring>
+#include <utility>
 
-bool ImageDocument::load(const QString& path) {
+// Reduced decoding only pays off for images this large.
+static const double kReducedMinPixels = 8e6;
+// The reduced decode keeps at least this many pixels on the longer side.
+static const int kReducedMinSide = 2048;
+// Smaller images decode faster than their raw copy is worth on disk.
+static const double kDecodedCacheMinPixels = 1e6;
+
+static quint64 nextGeneration() {
+    static std::atomic<quint64> counter { 0 };
+    return ++counter;
+}
+
+bool ImageDocument::load(const QString& path, bool allowReduced) {
+    IMAGELAB_TRACE_SCOPE("ImageDocument::load");
     imgPath = path;
-    original = cv::imread(path.toStdString(), cv::IMREAD_COLOR);
     processed = cv::Mat();
+    procScale = 1.0;
+    origScale = 1.0;
+    gen = nextGeneration();
+
+    if (decoded && decoded->lookup(path, original, &hash)) {
+        full = original.size();
+        return true;
+    }
+
+    int flags = cv::IMREAD_COLOR;
+    QImageReader reader(path);
+    const QSize size = reader.size();
+    const QByteArray format = reader.format();
+    if (allowReduced && (format == "jpeg" || format == "jpg") && double(size.width()) * size.height() >= kReducedMinPixels) {
+        const std::pair<int, int> reductions[] = { { 8, cv::IMREAD_REDUCED_COLOR_8 },
+                                                   { 4, cv::IMREAD_REDUCED_COLOR_4 },
+                                                   { 2, cv::IMREAD_REDUCED_COLOR_2 } };
+        for (const auto& r : reductions) {
+            if (qMax(size.width(), size.height()) / r.first >= kReducedMinSide) { flags = r.second; break; }
+        }
+    }
+
+    original = cv::imread(path.toStdString(), flags);
+    if (flags != cv::IMREAD_COLOR && !original.empty()) {
+        // imread applies EXIF orientation, the header size does not.
+        full = cv::Size(size.width(), size.height());
+        if ((original.cols > original.rows) != (full.width > full.height)) std::swap(full.width, full.height);
+        origScale = double(original.cols) / full.width;
+    } else {
+        full = original.size();
+    }
+    hash = hashPixels(original);
+    if (!isReduced()) storeDecoded();
     return !original.empty();
 }
 
-bool ImageDocument::saveProcessed(const QString& path) const {
-    if (processed.empty()) return false;
-    return cv::imwrite(path.toStdString(), processed);
+void ImageDocument::adopt(const QString& path, cv::Mat img, quint64 pixelHash) {
+    imgPath = path;
+    processed = cv::Mat();
+    procScale = 1.0;
+    origScale = 1.0;
+    gen = nextGeneration();
+    original = std::move(img);
+    full = original.size();
+    hash = pixelHash;
+}
+
+void ImageDocument::unload() {
+    original = cv::Mat();
+    processed = cv::Mat();
+    procScale = 1.0;
+}
+
+qint64 ImageDocument::residentBytes() const {
+    qint64 total = 0;
+    if (!original.empty()) total += qint64(original.total() * original.elemSize());
+    // Filters that change nothing return the original itself.
+    if (!processed.empty() && processed.datastart != original.datastart)
+        total += qint64(processed.total() * processed.elemSize());
+    return total;
+}
+
+void ImageDocument::storeDecoded() const {
+    if (!decoded || double(original.total()) < kDecodedCacheMinPixels) return;
+    QThreadPool::globalInstance()->start([cache = decoded, path = imgPath, img = original, h = hash] {
+        cache->store(path, img, h);
+    });
+}
+
+void ImageDocument::setFullResolution(cv::Mat fullImage, quint64 pixelHash) {
+    if (fullImage.empty()) return;
+    // Results rendered from the reduced decode stay on screen, scaled, until
+    // they are re-rendered.
+    original = std::move(fullImage);
+    full = original.size();
+    origScale = 1.0;
+    gen = nextGeneration();
+    hash = pixelHash;
+    storeDecoded();
+}
+
+bool ImageDocument::ensureFullResolution() {
+    if (!isReduced()) return hasImage();
+    IMAGELAB_TRACE_SCOPE("ImageDocument::ensureFullResolution");
+    cv::Mat img = cv::imread(imgPath.toStdString(), cv::IMREAD_COLOR);
+    if (img.empty()) return false;
+    const quint64 h = hashPixels(img);
+    setFullResolution(std::move(img), h);
+    return true;
+}
+
+quint64 ImageDocument::hashPixels(const cv::Mat& m) {
+    const quint64 k = 0x9E3779B97F4A7C15ull;
+    quint64 h = k ^ (quint64(m.rows) << 40) ^ (quint64(m.cols) << 16) ^ quint64(m.type());
+    if (m.empty()) return h;
+
+    const int rows = m.isContinuous() ? 1 : m.rows;
+    const size_t rowBytes = m.isContinuous() ? m.total() * m.elemSize() : m.cols * m.elemSize();
+    for (int y = 0; y < rows; ++y) {
+        const uchar* p = m.ptr(y);
+        size_t i = 0;
+        for (; i + 8 <= rowBytes; i += 8) {
+            quint64 v;
+            std::memcpy(&v, p + i, 8);
+            h = (h ^ v) * k;
+            h ^= h >> 29;
+        }
+        for (; i < rowBytes; ++i) h = (h ^ p[i]) * k;
+    }
+    return h;
 }
@@ -1,22 +1,69 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <QString>
+#include <QList>
+#include <memory>
+
+#include "SessionStore.h"
+
+class DecodedCache;
 
 class ImageDocument {
 public:
-    bool load(const QString& path);
-    bool saveProcessed(const QString& path) const;
+    // With allowReduced, large JPEGs are first decoded at 1/2, 1/4 or 1/8
+    // scale (DCT scaling, a fraction of the full decode time); the caller
+    // decodes the full image in the background and hands it to
+    // setFullResolution(). Everything else is decoded at full size.
+    bool load(const QString& path, bool allowReduced = false);
+    // Optional. load() maps cached decodes back in instead of decoding, and
+    // every full-resolution decode is written to the cache in the background.
+    void setDecodedCache(std::shared_ptr<DecodedCache> cache) { decoded = std::move(cache); }
+    // Takes an image decoded elsewhere (e.g. prefetched) as the new original.
+    void adopt(const QString& path, cv::Mat img, quint64 pixelHash);
+    bool isReduced() const { return origScale < 1.0; }
+    // Size of `original` relative to the file's full resolution.
+    double originalScale() const { return origScale; }
+    cv::Size fullSize() const { return full; }
+    void setFullResolution(cv::Mat fullImage, quint64 pixelHash);
+    // Blocking fallback for callers that need full resolution right now.
+    bool ensureFullResolution();
 
     bool hasImage() const { return !original.empty(); }
+    // Releases the pixels but keeps the path, hash and full size, so an
+    // unloaded document can still be described and loaded again.
+    void unload();
+    void dropProcessed() { processed = cv::Mat(); procScale = 1.0; }
+    // Bytes held by the original and the processed result, each buffer once.
+    qint64 residentBytes() const;
 
     const cv::Mat& originalMat() const { return original; }
     const cv::Mat& processedMat() const { return processed; }
 
-    void setProcessed(const cv::Mat& m) { processed = m.clone(); }
+    // Processed results are shared, never modified in place, so no copy is
+    // taken. `scale` is relative to originalMat(); processedScale() is
+    // relative to the full resolution.
+    void setProcessed(cv::Mat m, double scale = 1.0) { processed = std::move(m); procScale = scale * origScale; }
+    double processedScale() const { return procScale; }
+    bool processedIsPreview() const { return !processed.empty() && procScale < 1.0; }
     QString lastPath() const { return imgPath; }
+    // Changes whenever `original` is replaced; cheaper than comparing pixels.
+    // Unique across documents, so switching between them also changes it.
+    quint64 generation() const { return gen; }
+    // Hash of the decoded pixels; equal images reopened from anywhere match.
+    quint64 contentHash() const { return hash; }
+
+    static quint64 hashPixels(const cv::Mat& m);
 
 private:
+    void storeDecoded() const;
+
+    std::shared_ptr<DecodedCache> decoded;
     cv::Mat original;
     cv::Mat processed;
+    double procScale = 1.0;
+    double origScale = 1.0;
+    cv::Size full;
     QString imgPath;
+    quint64 gen = 0;
+    quint64 hash = 0;
 };
@@ -0,0 +1,93 @@
+#include "MatPool.h"
+
+#include <algorithm>
+
+static std::atomic<std::uint64_t> gAllocations { 0 };
+static std::atomic<std::uint64_t> gReuses { 0 };
+
+namespace {
+
+// Counts allocations and otherwise defers to OpenCV's standard allocator;
+// the UMatData it returns names the standard allocator, so frees go there.
+class CountingAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        if (!data) gAllocations.fetch_add(1, std::memory_order_relaxed);
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+    bool allocate(cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        return cv::Mat::getStdAllocator()->allocate(u, flags, usage);
+    }
+    void deallocate(cv::UMatData* u) const override {
+        cv::Mat::getStdAllocator()->deallocate(u);
+    }
+};
+
+}
+
+MatPool& MatPool::local() {
+    thread_local MatPool pool;
+    return pool;
+}
+
+void MatPool::enable(std::size_t bytes) {
+    maxBytes = bytes;
+    // Shrinking the cap drops the oldest buffers right away.
+    while (pooledBytes > maxBytes && !buffers.empty()) {
+        pooledBytes -= bytesOf(buffers.front());
+        buffers.erase(buffers.begin());
+    }
+}
+
+cv::Mat MatPool::acquire(cv::Size size, int type) {
+    if (maxBytes == 0) return cv::Mat(size, type);
+    if (!wasUsed(size, type)) used.push_back({ size, type });
+    for (auto& m : buffers) {
+        if (m.size() == size && m.type() == type && isIdle(m)) {
+            gReuses.fetch_add(1, std::memory_order_relaxed);
+            return m;
+        }
+    }
+    cv::Mat fresh(size, type);
+    const std::size_t bytes = bytesOf(fresh);
+    if (bytes > maxBytes) return fresh;
+    // Oldest first; dropping a buffer someone else still holds frees
+    // nothing but stops the pool from counting it.
+    while (pooledBytes + bytes > maxBytes) {
+        pooledBytes -= bytesOf(buffers.front());
+        buffers.erase(buffers.begin());
+    }
+    buffers.push_back(fresh);
+    pooledBytes += bytes;
+    return fresh;
+}
+
+bool MatPool::wasUsed(cv::Size size, int type) const {
+    return std::any_of(used.begin(), used.end(),
+                       [&](const Shape& u) { return u.size == size && u.type == type; });
+}
+
+void MatPool::trim() {
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        if (isIdle(*it) && !wasUsed(it->size(), it->type())) {
+            pooledBytes -= bytesOf(*it);
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    used.clear();
+}
+
+void MatPool::installCountingAllocator() {
+    static CountingAllocator allocator;
+    cv::Mat::setDefaultAllocator(&allocator);
+}
+
+MatPool::Counters MatPool::counters() {
+    Counters c;
+    c.allocations = gAllocations.load(std::memory_order_relaxed);
+    c.reuses = gReuses.load(std::memory_order_relaxed);
+    return c;
+}
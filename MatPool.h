@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Per-thread pool of image buffers for filter outputs and scratch planes.
+//
+// Results are shared by reference everywhere (pipeline cache, result cache,
+// viewer), so a buffer may only be handed out again once nobody else holds
+// it: acquire() reuses a pooled Mat only while the pool's reference is the
+// last one (u->refcount == 1). Repeated renders at one size then cycle
+// through the same few buffers instead of allocating fresh ones.
+//
+// Pooling is off unless enable() was called on the thread, so pool threads
+// and OpenCV's parallel_for_ workers never pin buffers; only the filter
+// worker, which renders the same sizes over and over, turns it on. A pool
+// holds at most maxBytes, and trim() after each render drops idle buffers
+// of sizes that render did not use, so memory the caches give up is not
+// kept alive here.
+//
+// Allocation counters cover every cv::Mat allocation in the process once
+// installCountingAllocator() has run, pooled or not.
+class MatPool {
+public:
+    struct Counters {
+        std::uint64_t allocations = 0; // new buffers from the heap (any cv::Mat)
+        std::uint64_t reuses = 0;      // acquire() calls served from a pool
+    };
+
+    static MatPool& local();
+
+    void enable(std::size_t maxBytes);
+    cv::Mat acquire(cv::Size size, int type);
+    cv::Mat acquire(int rows, int cols, int type) { return acquire(cv::Size(cols, rows), type); }
+    // Releases idle buffers of sizes not acquired since the previous trim().
+    void trim();
+
+    static void installCountingAllocator();
+    static Counters counters();
+
+private:
+    static bool isIdle(const cv::Mat& m) { return m.u && CV_XADD(&m.u->refcount, 0) == 1; }
+    static std::size_t bytesOf(const cv::Mat& m) { return m.total() * m.elemSize(); }
+    bool wasUsed(cv::Size size, int type) const;
+
+    struct Shape {
+        cv::Size size;
+        int type;
+    };
+
+    std::vector<cv::Mat> buffers;   // oldest first
+    std::vector<Shape> used;
+    std::size_t maxBytes = 0;       // 0: pooling disabled
+    std::size_t pooledBytes = 0;
+};
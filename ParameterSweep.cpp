@@ -0,0 +1,295 @@
+#include "ParameterSweep.h"
+#include "FftEngine.h"
+#include "FilterPipeline.h"
+#include "Filters.h"
+#include "Profiler.h"
+
+#include <QLocale>
+#include <algorithm>
+#include <cmath>
+
+bool ParameterSweep::parseAxis(const QString& spec, Axis& axis, QString* error) {
+    auto fail = [error](const QString& why) {
+        if (error) *error = why;
+        return false;
+    };
+    const int eq = spec.indexOf('=');
+    if (eq <= 0) return fail(QString("esperado parâmetro=valores em \"%1\"").arg(spec));
+
+    QString name = spec.left(eq).trimmed();
+    axis = Axis();
+    const int dot = name.indexOf('.');
+    if (dot > 0) {
+        bool ok = false;
+        const int stage = name.left(dot).toInt(&ok);
+        if (!ok || stage < 1) return fail(QString("etapa inválida em \"%1\"").arg(spec));
+        axis.stage = stage - 1;
+        name = name.mid(dot + 1);
+    }
+    if (!parameterNames().contains(name)) return fail(QString("parâmetro desconhecido: %1").arg(name));
+    axis.param = name;
+
+    const QLocale c = QLocale::c();
+    const QString values = spec.mid(eq + 1).trimmed();
+    if (values.contains(':')) {
+        const QStringList parts = values.split(':');
+        bool ok0 = false, ok1 = false, ok2 = true;
+        const double from = c.toDouble(parts.value(0), &ok0);
+        const double to = c.toDouble(parts.value(1), &ok1);
+        const double step = parts.size() > 2 ? c.toDouble(parts[2], &ok2) : 1.0;
+        if (parts.size() > 3 || !ok0 || !ok1 || !ok2 || step <= 0 || to < from)
+            return fail(QString("intervalo inválido em \"%1\" (use início:fim:passo)").arg(spec));
+        // Tolerate rounding so 0.1:0.5:0.1 includes 0.5.
+        // Checked as a double first: a huge range overflows int. The negated
+        // test also rejects NaN from infinite bounds.
+        const double count = std::floor((to - from) / step + 1e-9) + 1;
+        if (!(count <= kMaxCells)) return fail(QString("valores demais em \"%1\"").arg(spec));
+        const int n = int(count);
+        for (int i = 0; i < n; ++i) axis.values.push_back(from + i * step);
+    } else {
+        for (const QString& v : values.split(',')) {
+            bool ok = false;
+            axis.values.push_back(c.toDouble(v.trimmed(), &ok));
+            if (!ok) return fail(QString("valor inválido \"%1\" em \"%2\"").arg(v, spec));
+        }
+    }
+    return true;
+}
+
+QStringList ParameterSweep::parameterNames() {
+    return { "ksize", "sigma", "lowThresh", "highThresh", "brightness", "contrast", "gamma",
+             "threshold", "cutoff", "order", "notchU", "notchV", "notchRadius" };
+}
+
+QStringList ParameterSweep::parametersOf(const FilterConfig& cfg) {
+    // A parameter is in use if changing it changes what the pipeline computes.
+    QStringList out;
+    for (const QString& p : parameterNames()) {
+        FilterConfig probe = cfg;
+        setParameter(probe, p, parameter(cfg, p) + 1);
+        if (!FilterPipeline::sameParameters(cfg, probe)) out << p;
+    }
+    return out;
+}
+
+double ParameterSweep::parameter(const FilterConfig& cfg, const QString& param) {
+    if (param == "ksize") return cfg.ksize;
+    if (param == "sigma") return cfg.sigma;
+    if (param == "lowThresh") return cfg.lowThresh;
+    if (param == "highThresh") return cfg.highThresh;
+    if (param == "brightness") return cfg.brightness;
+    if (param == "contrast") return cfg.contrast;
+    if (param == "gamma") return cfg.gamma;
+    if (param == "threshold") return cfg.threshold;
+    if (param == "cutoff") return cfg.cutoff;
+    if (param == "order") return cfg.order;
+    if (param == "notchU") return cfg.notchU;
+    if (param == "notchV") return cfg.notchV;
+    if (param == "notchRadius") return cfg.notchRadius;
+    return 0.0;
+}
+
+bool ParameterSweep::setParameter(FilterConfig& cfg, const QString& param, double value) {
+    if (param == "ksize") cfg.ksize = qRound(value);
+    else if (param == "sigma") cfg.sigma = value;
+    else if (param == "lowThresh") cfg.lowThresh = qRound(value);
+    else if (param == "highThresh") cfg.highThresh = qRound(value);
+    else if (param == "brightness") cfg.brightness = qRound(value);
+    else if (param == "contrast") cfg.contrast = value;
+    else if (param == "gamma") cfg.gamma = value;
+    else if (param == "threshold") cfg.threshold = qRound(value);
+    else if (param == "cutoff") cfg.cutoff = value;
+    else if (param == "order") cfg.order = qRound(value);
+    else if (param == "notchU") cfg.notchU = qRound(value);
+    else if (param == "notchV") cfg.notchV = qRound(value);
+    else if (param == "notchRadius") cfg.notchRadius = value;
+    else return false;
+    return true;
+}
+
+ParameterSweep::ParameterSweep(QList<FilterConfig> stages, QList<Axis> axes)
+    : stages(std::move(stages)), axes(std::move(axes)) {}
+
+bool ParameterSweep::validate(QString* error) {
+    auto fail = [error](const QString& why) {
+        if (error) *error = why;
+        return false;
+    };
+    if (stages.isEmpty()) return fail("nenhuma etapa para varrer");
+
+    for (int a = 0; a < axes.size(); ++a) {
+        Axis& ax = axes[a];
+        if (ax.values.isEmpty()) return fail(QString("%1 não tem valores").arg(ax.param));
+        if (ax.stage < 0) {
+            for (int s = stages.size() - 1; s >= 0 && ax.stage < 0; --s)
+                if (parametersOf(stages[s]).contains(ax.param)) ax.stage = s;
+            if (ax.stage < 0) return fail(QString("nenhuma etapa usa %1").arg(ax.param));
+        } else if (ax.stage >= stages.size()) {
+            return fail(QString("a cadeia tem só %1 etapas").arg(stages.size()));
+        } else if (!parametersOf(stages[ax.stage]).contains(ax.param)) {
+            return fail(QString("o filtro da etapa %1 (%2) não usa %3")
+                            .arg(ax.stage + 1).arg(stages[ax.stage].name, ax.param));
+        }
+        for (int b = 0; b < a; ++b)
+            if (axes[b].stage == ax.stage && axes[b].param == ax.param)
+                return fail(QString("%1 aparece duas vezes").arg(ax.param));
+    }
+
+    qint64 cells = 1;
+    for (const Axis& ax : axes) cells *= ax.values.size();
+    if (cells > kMaxCells) return fail(QString("%1 combinações (máximo %2)").arg(cells).arg(kMaxCells));
+    return true;
+}
+
+int ParameterSweep::cellCount() const {
+    int n = 1;
+    for (const Axis& ax : axes) n *= ax.values.size();
+    return n;
+}
+
+QList<FilterConfig> ParameterSweep::stagesFor(int cell) const {
+    QList<FilterConfig> out = stages;
+    for (const Axis& ax : axes) {
+        setParameter(out[ax.stage], ax.param, ax.values[cell % ax.values.size()]);
+        cell /= ax.values.size();
+    }
+    return out;
+}
+
+QString ParameterSweep::labelFor(int cell) const {
+    QStringList parts;
+    for (const Axis& ax : axes) {
+        const QString name = stages.size() > 1 ? QString("%1.%2").arg(ax.stage + 1).arg(ax.param) : ax.param;
+        parts << QString("%1=%2").arg(name).arg(ax.values[cell % ax.values.size()]);
+        cell /= ax.values.size();
+    }
+    return parts.join(' ');
+}
+
+bool ParameterSweep::run(const cv::Mat& src, const CellCallback& onCell, double scale,
+                         const CancelCheck& cancelled, double sourceScale) const {
+    IMAGELAB_TRACE_SCOPE("ParameterSweep::run");
+    if (src.empty() || stages.isEmpty()) return false;
+
+    const bool preview = scale > 0.0 && scale < 1.0;
+    const double paramScale = (preview ? scale : 1.0) * sourceScale;
+    const int cells = cellCount();
+    std::vector<QList<FilterConfig>> chains(cells);
+    for (int c = 0; c < cells; ++c) {
+        chains[c] = stagesFor(c);
+        if (paramScale < 1.0)
+            for (auto& st : chains[c]) st = FilterPipeline::scaledForPreview(st, paramScale);
+    }
+
+    struct Node {
+        int parent;
+        int firstCell;
+        cv::Mat output;
+    };
+    std::vector<Node> prev(1);
+    prev[0] = { -1, 0, src };
+    if (preview) cv::resize(src, prev[0].output, cv::Size(), scale, scale, cv::INTER_AREA);
+    std::vector<int> nodeOf(cells, 0);
+
+    const int levels = stages.size();
+    for (int k = 0; k < levels; ++k) {
+        // Cells that agree on stage k and share the node above it share a node.
+        std::vector<Node> level;
+        std::vector<int> next(cells);
+        std::vector<std::vector<int>> cellsOf;
+        for (int c = 0; c < cells; ++c) {
+            int found = -1;
+            for (int j = 0; j < int(level.size()) && found < 0; ++j) {
+                if (level[j].parent == nodeOf[c]
+                        && FilterPipeline::sameParameters(chains[level[j].firstCell][k], chains[c][k]))
+                    found = j;
+            }
+            if (found < 0) {
+                found = int(level.size());
+                level.push_back({ nodeOf[c], c, cv::Mat() });
+                cellsOf.emplace_back();
+            }
+            next[c] = found;
+            cellsOf[found].push_back(c);
+        }
+        if (cancelled && cancelled()) return false;
+
+        // Siblings run next to each other so a block's FftEngine can reuse
+        // the forward transform of their shared input.
+        std::vector<int> order(level.size());
+        for (size_t j = 0; j < order.size(); ++j) order[j] = int(j);
+        std::stable_sort(order.begin(), order.end(),
+                         [&level](int a, int b) { return level[a].parent < level[b].parent; });
+
+        // Canny cells that differ only in their thresholds share the
+        // grayscale conversion and the gradients of their common input.
+        const bool canny = stages[k].name == "Canny";
+        std::vector<cv::Mat> dx, dy;
+        if (canny) {
+            std::vector<int> parents;
+            for (const Node& node : level)
+                if (std::find(parents.begin(), parents.end(), node.parent) == parents.end())
+                    parents.push_back(node.parent);
+            dx.resize(prev.size());
+            dy.resize(prev.size());
+            cv::parallel_for_(cv::Range(0, int(parents.size())), [&](const cv::Range& r) {
+                for (int i = r.start; i < r.end; ++i)
+                    Filters::cannyGradients(prev[parents[i]].output, dx[parents[i]], dy[parents[i]]);
+            });
+        }
+
+        const bool last = k == levels - 1;
+        const int n = int(order.size());
+        const int blocks = std::max(1, std::min(n, cv::getNumThreads()));
+        std::vector<FftEngine> engines(blocks);
+        cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range& r) {
+            for (int b = r.start; b < r.end; ++b) {
+                for (int i = b * n / blocks; i < (b + 1) * n / blocks; ++i) {
+                    if (cancelled && cancelled()) return;
+                    Node& node = level[order[i]];
+                    const FilterConfig& cfg = chains[node.firstCell][k];
+                    if (canny)
+                        node.output = Filters::cannyFromGradients(dx[node.parent], dy[node.parent],
+                                                                  cfg.lowThresh, cfg.highThresh);
+                    else
+                        node.output = FilterPipeline::applyStage(prev[node.parent].output, cfg, &engines[b]);
+                    if (!last) continue;
+                    for (int c : cellsOf[order[i]]) onCell(c, node.output);
+                    node.output.release();
+                }
+            }
+        });
+        if (cancelled && cancelled()) return false;
+        prev.swap(level);
+        nodeOf.swap(next);
+    }
+    return true;
+}
+
+cv::Mat ParameterSweep::contactSheet(const std::vector<cv::Mat>& cells, const QStringList& labels,
+                                     int columns, int cellSide) {
+    const int captionHeight = 18, gap = 4;
+    const int count = int(cells.size());
+    columns = std::max(1, std::min(columns, count));
+    const int rows = (count + columns - 1) / columns;
+    const int pitchX = cellSide + gap, pitchY = cellSide + captionHeight + gap;
+    cv::Mat sheet(rows * pitchY + gap, columns * pitchX + gap, CV_8UC3, cv::Scalar(40, 40, 40));
+
+    for (int i = 0; i < count; ++i) {
+        const int x0 = gap + (i % columns) * pitchX, y0 = gap + (i / columns) * pitchY;
+        const cv::Mat& m = cells[i];
+        if (!m.empty()) {
+            const double f = std::min(double(cellSide) / m.cols, double(cellSide) / m.rows);
+            const cv::Size fit(std::max(1, int(m.cols * f)), std::max(1, int(m.rows * f)));
+            cv::Mat scaled, bgr;
+            cv::resize(m, scaled, fit, 0, 0, f < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+            if (scaled.channels() == 1) cv::cvtColor(scaled, bgr, cv::COLOR_GRAY2BGR);
+            else bgr = scaled;
+            bgr.copyTo(sheet(cv::Rect(x0 + (cellSide - fit.width) / 2, y0 + (cellSide - fit.height) / 2,
+                                      fit.width, fit.height)));
+        }
+        cv::putText(sheet, labels.value(i).toStdString(), cv::Point(x0 + 2, y0 + cellSide + captionHeight - 5),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(230, 230, 230), 1, cv::LINE_AA);
+    }
+    return sheet;
+}
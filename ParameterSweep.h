@@ -0,0 +1,66 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "SessionStore.h"
+
+// Evaluates a filter chain over a grid of parameter values (e.g. Canny low x
+// high). The grid is run as a tree, one level per stage: cells whose chains
+// agree up to a stage share that node, so the stages before the first swept
+// one run once. Canny nodes with a common input also share its grayscale
+// conversion and gradients, so a threshold sweep only repeats hysteresis.
+// The distinct nodes of a level run in parallel.
+class ParameterSweep {
+public:
+    struct Axis {
+        int stage = -1;   // index into the stages; -1: last stage that uses `param`
+        QString param;    // FilterConfig field, e.g. "lowThresh"
+        QVector<double> values;
+    };
+
+    using CellCallback = std::function<void(int cell, const cv::Mat& result)>;
+    using CancelCheck = std::function<bool()>;
+
+    static const int kMaxCells = 400;
+
+    // "lowThresh=20:100:20" (start:end:step), "sigma=1,2,4", or "2.sigma=..."
+    // to name the stage (1-based, as in the stage list).
+    static bool parseAxis(const QString& spec, Axis& axis, QString* error = nullptr);
+    static QStringList parameterNames();
+    // The parameters the filter of `cfg` actually reads.
+    static QStringList parametersOf(const FilterConfig& cfg);
+    static double parameter(const FilterConfig& cfg, const QString& param);
+    static bool setParameter(FilterConfig& cfg, const QString& param, double value);
+
+    ParameterSweep(QList<FilterConfig> stages, QList<Axis> axes);
+
+    // Resolves axis stages and checks the grid size; call before run().
+    bool validate(QString* error = nullptr);
+
+    int cellCount() const;
+    // Cells are laid out with the first axis varying fastest.
+    int columns() const { return axes.isEmpty() ? 1 : axes.first().values.size(); }
+    QList<FilterConfig> stagesFor(int cell) const;
+    QString labelFor(int cell) const;
+
+    // Calls onCell once per cell, from worker threads, as soon as its result
+    // is ready. scale < 1 runs on a downscaled proxy with spatial parameters
+    // scaled, as FilterPipeline previews do; `sourceScale` is the size of
+    // `src` relative to the full resolution (see FilterPipeline::run).
+    // Returns false if cancelled.
+    bool run(const cv::Mat& src, const CellCallback& onCell, double scale = 1.0,
+             const CancelCheck& cancelled = CancelCheck(), double sourceScale = 1.0) const;
+
+    // Cells fitted into cellSide squares, captioned, `columns` per row.
+    static cv::Mat contactSheet(const std::vector<cv::Mat>& cells, const QStringList& labels,
+                                int columns, int cellSide);
+
+private:
+    QList<FilterConfig> stages;
+    QList<Axis> axes;
+};
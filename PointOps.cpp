@@ -0,0 +1,71 @@
+#include "PointOps.h"
+#include "MatPool.h"
+#include <cmath>
+
+PointOpChain::PointOpChain() {
+    for (auto& t : tables)
+        for (int v = 0; v < 256; ++v) t[v] = uchar(v);
+}
+
+template <class F>
+PointOpChain& PointOpChain::compose(F f, int channel) {
+    for (int c = 0; c < 3; ++c) {
+        if (channel >= 0 && c != channel) continue;
+        for (auto& v : tables[c]) v = f(v);
+    }
+    if (channel >= 0) perChannel = true;
+    return *this;
+}
+
+PointOpChain& PointOpChain::brightnessContrast(int brightness, double contrast) {
+    // Same float arithmetic and rounding as Mat::convertTo(-1, alpha, beta).
+    const float a = float(contrast), b = float(brightness);
+    return compose([a, b](uchar v) { return cv::saturate_cast<uchar>(v * a + b); });
+}
+
+PointOpChain& PointOpChain::gamma(double gamma) {
+    Table t;
+    const double e = 1.0 / std::max(gamma, 1e-3);
+    for (int v = 0; v < 256; ++v) t[v] = cv::saturate_cast<uchar>(255.0 * std::pow(v / 255.0, e));
+    return compose([&t](uchar v) { return t[v]; });
+}
+
+PointOpChain& PointOpChain::invert() {
+    return compose([](uchar v) { return uchar(255 - v); });
+}
+
+PointOpChain& PointOpChain::threshold(int thresh) {
+    return compose([thresh](uchar v) { return uchar(v > thresh ? 255 : 0); });
+}
+
+PointOpChain& PointOpChain::curve(const Table& table, int channel) {
+    return compose([&table](uchar v) { return table[v]; }, channel);
+}
+
+bool PointOpChain::isIdentity() const {
+    for (const auto& t : tables)
+        for (int v = 0; v < 256; ++v)
+            if (t[v] != v) return false;
+    return true;
+}
+
+cv::Mat PointOpChain::lut() const {
+    if (!perChannel) return cv::Mat(1, 256, CV_8UC1, const_cast<uchar*>(tables[0].data())).clone();
+    cv::Mat out(1, 256, CV_8UC3);
+    auto* p = out.ptr<cv::Vec3b>();
+    for (int v = 0; v < 256; ++v) p[v] = cv::Vec3b(tables[0][v], tables[1][v], tables[2][v]);
+    return out;
+}
+
+cv::Mat PointOpChain::apply(const cv::Mat& src) const {
+    cv::Mat in = src;
+    if (src.depth() != CV_8U) src.convertTo(in, CV_8U);
+
+    cv::Mat table = lut();
+    if (table.channels() != 1 && in.channels() != table.channels()) {
+        table = cv::Mat(1, 256, CV_8UC1, const_cast<uchar*>(tables[0].data()));
+    }
+    cv::Mat out = MatPool::local().acquire(in.size(), in.type());
+    cv::LUT(in, table, out);
+    return out;
+}
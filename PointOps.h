@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <opencv2/opencv.hpp>
+
+// Per-pixel 8-bit operations composed into one 256-entry table per channel.
+// Each operation is folded into the tables as it is added, so a chain of any
+// length costs a single cv::LUT pass (vectorized, and split across threads
+// by OpenCV for large images). Composing in the 8-bit domain saturates after
+// every step, exactly like running the operations one after another.
+class PointOpChain {
+public:
+    using Table = std::array<uchar, 256>;
+
+    PointOpChain();
+
+    PointOpChain& brightnessContrast(int brightness, double contrast);
+    // out = 255 * (in / 255)^(1 / gamma); gamma > 1 brightens.
+    PointOpChain& gamma(double gamma);
+    PointOpChain& invert();
+    // Binary threshold: in > thresh ? 255 : 0.
+    PointOpChain& threshold(int thresh);
+    // `channel` is the BGR index, or -1 to apply the curve to every channel.
+    PointOpChain& curve(const Table& table, int channel = -1);
+
+    bool isIdentity() const;
+    // 1x256 CV_8UC1 when all channels share a table, CV_8UC3 otherwise.
+    cv::Mat lut() const;
+    // 8-bit input only; other depths are converted to 8 bits first. A
+    // single-channel image uses the blue-channel table of per-channel curves.
+    cv::Mat apply(const cv::Mat& src) const;
+
+private:
+    template <class F> PointOpChain& compose(F f, int channel = -1);
+
+    std::array<Table, 3> tables;
+    bool perChannel = false;
+};
@@ -0,0 +1,74 @@
+#include "Profiler.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+// Enough for several minutes of interactive use.
+static const size_t kRingCapacity = 1 << 16;
+
+Profiler& Profiler::instance() {
+    static Profiler p;
+    return p;
+}
+
+Profiler::Profiler() {
+    clock.start();
+    ring.resize(kRingCapacity);
+}
+
+int Profiler::threadIndex() {
+    static std::atomic<int> counter { 0 };
+    thread_local const int index = ++counter;
+    return index;
+}
+
+void Profiler::record(const QByteArray& name, qint64 startNs, qint64 durationNs) {
+    if (!isEnabled()) return;
+    const int tid = threadIndex();
+    QMutexLocker lock(&mutex);
+    Event& e = ring[next];
+    e.name = name;
+    e.start = startNs;
+    e.duration = durationNs;
+    e.thread = tid;
+    if (++next == ring.size()) {
+        next = 0;
+        wrapped = true;
+    }
+}
+
+void Profiler::clear() {
+    QMutexLocker lock(&mutex);
+    next = 0;
+    wrapped = false;
+}
+
+bool Profiler::writeChromeTrace(const QString& path) const {
+    QJsonArray events;
+    {
+        QMutexLocker lock(&mutex);
+        const size_t count = wrapped ? ring.size() : next;
+        const size_t first = wrapped ? next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Event& e = ring[(first + i) % ring.size()];
+            QJsonObject o;
+            o["name"] = QString::fromUtf8(e.name);
+            o["ph"] = "X";
+            o["ts"] = e.start / 1000.0;     // microseconds
+            o["dur"] = e.duration / 1000.0;
+            o["pid"] = 1;
+            o["tid"] = e.thread;
+            events.append(o);
+        }
+    }
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return f.commit();
+}
@@ -0,0 +1,48 @@
+#include "ResultCache.h"
+#include "FilterPipeline.h"
+
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <climits>
+
+ResultCache::ResultCache(qint64 budgetBytes) {
+    setBudget(budgetBytes);
+}
+
+QByteArray ResultCache::keyFor(quint64 imageHash, const QList<FilterConfig>& stages, double scale) {
+    QList<FilterConfig> effective;
+    for (const auto& st : stages) effective.push_back(FilterPipeline::canonical(st));
+
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    h.addData(reinterpret_cast<const char*>(&imageHash), sizeof(imageHash));
+    h.addData(reinterpret_cast<const char*>(&scale), sizeof(scale));
+    h.addData(QJsonDocument(SessionStore::toJson(effective)).toJson(QJsonDocument::Compact));
+    return h.result();
+}
+
+bool ResultCache::lookup(const QByteArray& key, cv::Mat& out) {
+    if (const cv::Mat* m = cache.object(key)) {
+        out = *m;
+        return true;
+    }
+    return false;
+}
+
+void ResultCache::insert(const QByteArray& key, const cv::Mat& result) {
+    if (result.empty()) return;
+    cache.insert(key, new cv::Mat(result), costOf(result));
+}
+
+void ResultCache::setBudget(qint64 bytes) {
+    cache.setMaxCost(int(qBound<qint64>(1, bytes >> 10, INT_MAX)));
+}
+
+ResultCache::Stats ResultCache::stats() const {
+    Stats s;
+    s.hits = hits;
+    s.misses = misses;
+    s.residentBytes = qint64(cache.totalCost()) << 10;
+    s.budgetBytes = qint64(cache.maxCost()) << 10;
+    s.entries = int(cache.count());
+    return s;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QByteArray>
+#include <QCache>
+#include <QList>
+#include <opencv2/opencv.hpp>
+
+#include "SessionStore.h"
+
+// Byte-budgeted LRU cache of finished filter results, keyed by the source
+// image's content hash, the effective parameters of every stage and the
+// render scale.
+class ResultCache {
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        qint64 residentBytes = 0;
+        qint64 budgetBytes = 0;
+        int entries = 0;
+    };
+
+    explicit ResultCache(qint64 budgetBytes = qint64(256) << 20);
+
+    static QByteArray keyFor(quint64 imageHash, const QList<FilterConfig>& stages, double scale);
+
+    // Does not touch the statistics: a single edit may probe several
+    // scales, so callers report its outcome once with recordLookup().
+    bool lookup(const QByteArray& key, cv::Mat& out);
+    void recordLookup(bool hit) { ++(hit ? hits : misses); }
+    void insert(const QByteArray& key, const cv::Mat& result);
+    void setBudget(qint64 bytes);
+    void clear() { cache.clear(); }
+    Stats stats() const;
+
+private:
+    // QCache costs are ints; account in KiB so multi-GB budgets fit.
+    static int costOf(const cv::Mat& m) { return int(qMax<qint64>(1, qint64(m.total() * m.elemSize()) >> 10)); }
+
+    QCache<QByteArray, cv::Mat> cache;
+    quint64 hits = 0;
+    quint64 misses = 0;
+};
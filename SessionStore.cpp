@@ -1,9 +1,20 @@
 #include "SessionStore.h"
+#include "Profiler.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 
+static const int kCompactAfterAppends = 5000;
+
+SessionStore::SessionStore(QString file) : sessionFile(std::move(file)) {
+    const QFileInfo fi(sessionFile);
+    journalFile = fi.dir().filePath(fi.completeBaseName() + ".history.jsonl");
+}
+
 QJsonObject SessionStore::toJson(const FilterConfig& cfg) {
     QJsonObject o;
     o["name"] = cfg.name;
@@ -13,6 +24,14 @@ QJsonObject SessionStore::toJson(const FilterConfig& cfg) {
     o["highThresh"] = cfg.highThresh;
     o["brightness"] = cfg.brightness;
     o["contrast"] = cfg.contrast;
+    o["gamma"] = cfg.gamma;
+    o["threshold"] = cfg.threshold;
+    o["freqShape"] = cfg.freqShape;
+    o["cutoff"] = cfg.cutoff;
+    o["order"] = cfg.order;
+    o["notchU"] = cfg.notchU;
+    o["notchV"] = cfg.notchV;
+    o["notchRadius"] = cfg.notchRadius;
     return o;
 }
 
@@ -24,6 +43,67 @@ void SessionStore::fromJson(const QJsonObject& o, FilterConfig& cfg) {
     cfg.highThresh = o.value("highThresh").toInt(150);
     cfg.brightness = o.value("brightness").toInt(0);
     cfg.contrast = o.value("contrast").toDouble(1.0);
+    cfg.gamma = o.value("gamma").toDouble(1.0);
+    cfg.threshold = o.value("threshold").toInt(128);
+    cfg.freqShape = o.value("freqShape").toString("Butterworth");
+    cfg.cutoff = o.value("cutoff").toDouble(30.0);
+    cfg.order = o.value("order").toInt(2);
+    cfg.notchU = o.value("notchU").toInt(20);
+    cfg.notchV = o.value("notchV").toInt(0);
+    cfg.notchRadius = o.value("notchRadius").toDouble(5.0);
+}
+
+QJsonArray SessionStore::toJson(const QList<FilterConfig>& stages) {
+    QJsonArray arr;
+    for (const auto& cfg : stages) arr.append(toJson(cfg));
+    return arr;
+}
+
+QList<FilterConfig> SessionStore::stagesFromJson(const QJsonObject& root) {
+    QList<FilterConfig> out;
+    const auto arr = root.value("pipeline").toArray();
+    for (const auto& v : arr) {
+        FilterConfig cfg;
+        fromJson(v.toObject(), cfg);
+        out.push_back(cfg);
+    }
+    if (out.isEmpty()) {
+        FilterConfig cfg;
+        fromJson(root.value("filter").toObject(), cfg);
+        out.push_back(cfg);
+    }
+    return out;
+}
+
+QStringList SessionStore::filterNames() {
+    return {
+        "Nenhum",
+        "Escala de Cinza",
+        "Equalização de Histograma",
+        "Desfoque Gaussiano",
+        "Canny",
+        "Brilho/Contraste",
+        "Gama",
+        "Inverter",
+        "Limiar",
+        "Espectro (FFT)",
+        "Passa-Baixa (FFT)",
+        "Passa-Alta (FFT)",
+        "Notch (FFT)"
+    };
+}
+
+QString SessionStore::mapLegacyFilterName(const QString& legacy) {
+    static const QHash<QString, QString> m = {
+        {"None", "Nenhum"},
+        {"Grayscale", "Escala de Cinza"},
+        {"EqualizeHist", "Equalização de Histograma"},
+        {"GaussianBlur", "Desfoque Gaussiano"},
+        {"Canny", "Canny"},
+        {"BrightnessContrast", "Brilho/Contraste"},
+        {"FFT", "Espectro (FFT)"}
+    };
+    return m.value(legacy, legacy);
 }
 
 QJsonObject SessionStore::toJson(const HistoryEntry& e) {
@@ -49,24 +129,37 @@ QJsonObject SessionStore::readRoot() const {
 }
 
 bool SessionStore::writeRoot(const QJsonObject& root) const {
-    QFile f(sessionFile);
+    IMAGELAB_TRACE_SCOPE("SessionStore::writeRoot");
+    QSaveFile f(sessionFile);
     if (!f.open(QIODevice::WriteOnly)) return false;
     f.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
-    return true;
+    return f.commit();
 }
 
 bool SessionStore::save(const QString& lastImagePath, const FilterConfig& cfg) const {
+    return save(lastImagePath, QList<FilterConfig>{ cfg });
+}
+
+bool SessionStore::load(QString& lastImagePath, FilterConfig& cfg) const {
+    QList<FilterConfig> stages;
+    if (!load(lastImagePath, stages)) return false;
+    cfg = stages.first();
+    return true;
+}
+
+bool SessionStore::save(const QString& lastImagePath, const QList<FilterConfig>& stages) const {
     auto root = readRoot();
     root["lastImagePath"] = lastImagePath;
-    root["filter"] = toJson(cfg);
+    root["filter"] = stages.isEmpty() ? toJson(FilterConfig()) : toJson(stages.first());
+    root["pipeline"] = toJson(stages);
     return writeRoot(root);
 }
 
-bool SessionStore::load(QString& lastImagePath, FilterConfig& cfg) const {
+bool SessionStore::load(QString& lastImagePath, QList<FilterConfig>& stages) const {
     auto root = readRoot();
     if (root.isEmpty()) return false;
     lastImagePath = root.value("lastImagePath").toString();
-    fromJson(root.value("filter").toObject(), cfg);
+    stages = stagesFromJson(root);
     return true;
 }
 
@@ -86,28 +179,148 @@ QStringList SessionStore::loadRecent() const {
     return out;
 }
 
-void SessionStore::appendHistory(const QString& imagePath, const HistoryEntry& entry) const {
+bool SessionStore::saveSetting(const QString& key, const QJsonValue& value) const {
     auto root = readRoot();
+    auto settings = root.value("settings").toObject();
+    settings[key] = value;
+    root["settings"] = settings;
+    return writeRoot(root);
+}
 
-    QJsonObject historyMap = root.value("history").toObject();
-    QJsonArray list = historyMap.value(imagePath).toArray();
-    list.append(toJson(entry));
-    historyMap[imagePath] = list;
-    root["history"] = historyMap;
+QJsonValue SessionStore::loadSetting(const QString& key, const QJsonValue& fallback) const {
+    const auto settings = readRoot().value("settings").toObject();
+    return settings.contains(key) ? settings.value(key) : fallback;
+}
 
-    root["lastImagePath"] = imagePath;
+void SessionStore::appendHistory(const QString& imagePath, const HistoryEntry& entry) const {
+    ensureHistoryIndex();
+    appendJournalLine(imagePath, entry);
 
-    writeRoot(root);
+    if (lastRecordedImage != imagePath) {
+        auto root = readRoot();
+        root["lastImagePath"] = imagePath;
+        if (writeRoot(root)) lastRecordedImage = imagePath;
+    }
+
+    if (++appendsSinceCompaction >= kCompactAfterAppends) compactJournal();
 }
 
 QList<HistoryEntry> SessionStore::loadHistory(const QString& imagePath) const {
+    ensureHistoryIndex();
     QList<HistoryEntry> out;
-    auto root = readRoot();
-    auto historyMap = root.value("history").toObject();
-    auto list = historyMap.value(imagePath).toArray();
-    out.reserve(list.size());
-    for (const auto& v : list) {
-        out.push_back(fromJsonHist(v.toObject()));
+    const auto offsets = historyIndex.value(imagePath);
+    if (offsets.isEmpty()) return out;
+
+    QFile f(journalFile);
+    if (!f.open(QIODevice::ReadOnly)) return out;
+    out.reserve(offsets.size());
+    for (qint64 off : offsets) {
+        if (!f.seek(off)) break;
+        const auto doc = QJsonDocument::fromJson(f.readLine());
+        if (doc.isObject()) out.push_back(fromJsonHist(doc.object()));
     }
     return out;
 }
+
+void SessionStore::ensureHistoryIndex() const {
+    if (historyIndexed && QFileInfo(journalFile).size() == journalSize) return;
+    scanJournal();
+    if (!historyIndexed) {
+        historyIndexed = true;
+        migrateLegacyHistory();
+    }
+}
+
+void SessionStore::scanJournal() const {
+    historyIndex.clear();
+    journalSize = 0;
+    tornTail = false;
+
+    QFile f(journalFile);
+    if (!f.open(QIODevice::ReadOnly)) return;
+    bool damaged = false;
+    while (!f.atEnd()) {
+        const qint64 off = f.pos();
+        const QByteArray line = f.readLine();
+        // A line without its newline is a write interrupted by a crash.
+        tornTail = !line.endsWith('\n');
+        const auto doc = tornTail ? QJsonDocument() : QJsonDocument::fromJson(line);
+        if (!doc.isObject()) {
+            damaged = true;
+            continue;
+        }
+        historyIndex[doc.object().value("image").toString()].push_back(off);
+    }
+    journalSize = f.size();
+    f.close();
+    if (damaged) compactJournal();
+}
+
+// Sessions written before the journal kept history inside session.json.
+void SessionStore::migrateLegacyHistory() const {
+    auto root = readRoot();
+    if (!root.contains("history")) return;
+    const auto historyMap = root.value("history").toObject();
+    for (auto it = historyMap.begin(); it != historyMap.end(); ++it) {
+        for (const auto& v : it.value().toArray())
+            appendJournalLine(it.key(), fromJsonHist(v.toObject()));
+    }
+    root.remove("history");
+    writeRoot(root);
+}
+
+bool SessionStore::appendJournalLine(const QString& imagePath, const HistoryEntry& entry) const {
+    IMAGELAB_TRACE_SCOPE("SessionStore::appendJournalLine");
+    auto o = toJson(entry);
+    o["image"] = imagePath;
+    QByteArray line = QJsonDocument(o).toJson(QJsonDocument::Compact);
+    line += '\n';
+
+    // ensureHistoryIndex() has checked the size, so the scan's view of the
+    // file is current. Never glue a new record onto a torn one left by a crash.
+    qint64 off = journalSize;
+    if (tornTail) {
+        line.prepend('\n');
+        off += 1;
+    }
+
+    QFile f(journalFile);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+    if (f.write(line) != line.size() || !f.flush()) return false;
+
+    tornTail = false;
+    historyIndex[imagePath].push_back(off);
+    journalSize = f.size();
+    return true;
+}
+
+void SessionStore::compactJournal() const {
+    IMAGELAB_TRACE_SCOPE("SessionStore::compactJournal");
+    appendsSinceCompaction = 0;
+
+    QFile in(journalFile);
+    if (!in.open(QIODevice::ReadOnly)) return;
+    QSaveFile out(journalFile);
+    if (!out.open(QIODevice::WriteOnly)) return;
+
+    // Every indexed entry is kept; only torn or unparsable lines (which the
+    // index never points at) are left behind.
+    QHash<QString, QVector<qint64>> newIndex;
+    qint64 pos = 0;
+    for (auto it = historyIndex.cbegin(); it != historyIndex.cend(); ++it) {
+        for (qint64 off : it.value()) {
+            if (!in.seek(off)) continue;
+            const QByteArray line = in.readLine();
+            if (!line.endsWith('\n')) continue;
+            newIndex[it.key()].push_back(pos);
+            out.write(line);
+            pos += line.size();
+        }
+    }
+    in.close();
+    if (!out.commit()) return;
+
+    historyIndex = newIndex;
+    journalSize = pos;
+    tornTail = false;
+}
@@ -1,7 +1,11 @@
 #pragma once
 #include <QString>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
 
 struct FilterConfig {
     QString name;
@@ -11,6 +15,15 @@ struct FilterConfig {
     int    highThresh = 150;
     int    brightness = 0;
     double contrast = 1.0;
+    double gamma = 1.0;
+    int    threshold = 128;
+    // Frequency-domain filters (FftEngine); distances in cycles per image.
+    QString freqShape = "Butterworth";
+    double cutoff = 30.0;
+    int    order = 2;
+    int    notchU = 20;
+    int    notchV = 0;
+    double notchRadius = 5.0;
 };
 
 struct HistoryEntry {
@@ -18,28 +31,64 @@ struct HistoryEntry {
     QString operation;
 };
 
+// History is kept out of the session file, in an append-only journal next to
+// it (one compact JSON object per line). Appending never rewrites existing
+// data; an in-memory per-image index of line offsets is built on first use so
+// loadHistory only reads that image's lines. Once enough appends pile up (or
+// a crash left a torn line) the journal is compacted: every entry is kept,
+// grouped per image, torn lines are dropped and the file is atomically
+// replaced.
 class SessionStore {
 public:
-    explicit SessionStore(QString file = "session.json") : sessionFile(std::move(file)) {}
+    explicit SessionStore(QString file = "session.json");
 
     bool save(const QString& lastImagePath, const FilterConfig& cfg) const;
     bool load(QString& lastImagePath, FilterConfig& cfg) const;
 
+    bool save(const QString& lastImagePath, const QList<FilterConfig>& stages) const;
+    bool load(QString& lastImagePath, QList<FilterConfig>& stages) const;
+
     bool saveRecent(const QStringList& recent) const;
     QStringList loadRecent() const;
 
+    bool saveSetting(const QString& key, const QJsonValue& value) const;
+    QJsonValue loadSetting(const QString& key, const QJsonValue& fallback = QJsonValue()) const;
+
     void appendHistory(const QString& imagePath, const HistoryEntry& entry) const;
     QList<HistoryEntry> loadHistory(const QString& imagePath) const;
 
-private:
-    QString sessionFile;
-
     static QJsonObject toJson(const FilterConfig& cfg);
     static void fromJson(const QJsonObject& o, FilterConfig& cfg);
 
+    static QJsonArray toJson(const QList<FilterConfig>& stages);
+    static QList<FilterConfig> stagesFromJson(const QJsonObject& root);
+
+    // Every filter name FilterConfig::name may hold, in menu order.
+    static QStringList filterNames();
+    // Names written by older versions ("GaussianBlur", ...) to current ones;
+    // anything else is returned unchanged.
+    static QString mapLegacyFilterName(const QString& legacy);
+
+private:
+    QString sessionFile;
+
     static QJsonObject toJson(const HistoryEntry& e);
     static HistoryEntry fromJsonHist(const QJsonObject& o);
 
     QJsonObject readRoot() const;
     bool writeRoot(const QJsonObject& root) const;
+
+    void ensureHistoryIndex() const;
+    void scanJournal() const;
+    void migrateLegacyHistory() const;
+    bool appendJournalLine(const QString& imagePath, const HistoryEntry& entry) const;
+    void compactJournal() const;
+
+    QString journalFile;
+    mutable QHash<QString, QVector<qint64>> historyIndex;
+    mutable bool historyIndexed = false;
+    mutable qint64 journalSize = 0;
+    mutable bool tornTail = false;   // the last line lacks its newline
+    mutable int appendsSinceCompaction = 0;
+    mutable QString lastRecordedImage;
 };
@@ -0,0 +1,207 @@
+#include "SweepDialog.h"
+#include "Filters.h"
+
+#include <QApplication>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QIcon>
+#include <QLabel>
+#include <QListWidget>
+#include <QMessageBox>
+#include <QPixmap>
+#include <QPointer>
+#include <QPushButton>
+#include <QThreadPool>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+
+// Typical increment per parameter, used to seed the ranges.
+static double defaultStep(const QString& param) {
+    if (param == "ksize") return 2;
+    if (param == "sigma" || param == "notchRadius") return 0.5;
+    if (param == "contrast" || param == "gamma") return 0.25;
+    if (param == "order") return 1;
+    if (param == "notchU" || param == "notchV") return 5;
+    return 10;
+}
+
+SweepDialog::SweepDialog(const cv::Mat& image, const QList<FilterConfig>& stages, int stage,
+                         double previewScale, double sourceScale, QWidget* parent)
+    : QDialog(parent), image(image), stages(stages), stage(stage), previewScale(previewScale),
+      sourceScale(sourceScale)
+{
+    setWindowTitle(QString("Varredura de parâmetros — etapa %1 (%2)").arg(stage + 1).arg(stages[stage].name));
+    resize(900, 700);
+
+    const QStringList params = ParameterSweep::parametersOf(stages[stage]);
+    auto* form = new QFormLayout;
+    for (int i = 0; i < 2; ++i) {
+        AxisRow& r = rows[i];
+        r.param = new QComboBox(this);
+        if (i > 0) r.param->addItem("—");
+        r.param->addItems(params);
+        if (i > 0 && params.size() > 1) r.param->setCurrentIndex(2);
+        r.from = new QDoubleSpinBox(this);
+        r.to = new QDoubleSpinBox(this);
+        r.step = new QDoubleSpinBox(this);
+        for (auto* s : { r.from, r.to }) s->setRange(-4000.0, 4000.0);
+        r.step->setRange(0.01, 1000.0);
+        auto* line = new QHBoxLayout;
+        line->addWidget(r.param, 1);
+        line->addWidget(new QLabel("de", this));
+        line->addWidget(r.from);
+        line->addWidget(new QLabel("até", this));
+        line->addWidget(r.to);
+        line->addWidget(new QLabel("passo", this));
+        line->addWidget(r.step);
+        form->addRow(i == 0 ? "Colunas:" : "Linhas:", line);
+        connect(r.param, &QComboBox::currentTextChanged, this, [this, i]{ resetRange(rows[i]); });
+        resetRange(r);
+    }
+
+    auto* btRun = new QPushButton("Executar", this);
+    btSave = new QPushButton("Salvar folha...", this);
+    btSave->setEnabled(false);
+    connect(btRun, &QPushButton::clicked, this, &SweepDialog::runSweep);
+    connect(btSave, &QPushButton::clicked, this, &SweepDialog::saveSheet);
+    status = new QLabel(this);
+    auto* actions = new QHBoxLayout;
+    actions->addWidget(btRun);
+    actions->addWidget(btSave);
+    actions->addWidget(status, 1);
+
+    grid = new QListWidget(this);
+    grid->setViewMode(QListView::IconMode);
+    grid->setIconSize(QSize(kThumbSide, kThumbSide));
+    grid->setResizeMode(QListView::Adjust);
+    grid->setMovement(QListView::Static);
+    grid->setUniformItemSizes(true);
+    grid->setSpacing(4);
+    connect(grid, &QListWidget::itemActivated, this, &QDialog::accept);
+
+    auto* buttons = new QDialogButtonBox(this);
+    auto* btUse = buttons->addButton("Usar selecionada", QDialogButtonBox::AcceptRole);
+    buttons->addButton(QDialogButtonBox::Close);
+    btUse->setEnabled(false);
+    connect(grid, &QListWidget::currentRowChanged, this, [btUse](int row){ btUse->setEnabled(row >= 0); });
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* v = new QVBoxLayout(this);
+    v->addLayout(form);
+    v->addLayout(actions);
+    v->addWidget(grid, 1);
+    v->addWidget(buttons);
+}
+
+SweepDialog::~SweepDialog()
+{
+    cancelRun();
+}
+
+void SweepDialog::resetRange(const AxisRow& row)
+{
+    const QString p = row.param->currentText();
+    const bool active = ParameterSweep::parameterNames().contains(p);
+    for (auto* s : { row.from, row.to, row.step }) s->setEnabled(active);
+    if (!active) return;
+    const double step = defaultStep(p);
+    const double value = ParameterSweep::parameter(stages[stage], p);
+    row.step->setValue(step);
+    row.from->setValue(value - 2 * step);
+    row.to->setValue(value + 2 * step);
+}
+
+void SweepDialog::cancelRun()
+{
+    if (cancelFlag) cancelFlag->store(true);
+    cancelFlag.reset();
+}
+
+FilterConfig SweepDialog::chosen() const
+{
+    const int cell = grid->currentRow();
+    if (cell < 0 || cell >= sweep.cellCount()) return stages[stage];
+    return sweep.stagesFor(cell)[stage];
+}
+
+void SweepDialog::runSweep()
+{
+    QList<ParameterSweep::Axis> axes;
+    for (const AxisRow& r : rows) {
+        if (!r.from->isEnabled()) continue;
+        ParameterSweep::Axis ax;
+        ax.stage = stage;
+        ax.param = r.param->currentText();
+        // One value past the limit is enough for validate() to reject the grid.
+        // Clamped as a double, before the conversion, so wide ranges cannot overflow.
+        const double count = std::floor((r.to->value() - r.from->value()) / r.step->value() + 1e-9) + 1;
+        const int n = int(std::min(count, double(ParameterSweep::kMaxCells + 1)));
+        for (int i = 0; i < n; ++i)
+            ax.values.push_back(r.from->value() + i * r.step->value());
+        axes.push_back(ax);
+    }
+    ParameterSweep next(stages, axes);
+    QString why;
+    if (!next.validate(&why)) {
+        QMessageBox::warning(this, "Varredura", QString("Varredura inválida: %1.").arg(why));
+        return;
+    }
+
+    cancelRun();
+    sweep = next;
+    const quint64 id = ++runId;
+    const int cells = sweep.cellCount();
+    thumbs.assign(cells, cv::Mat());
+    grid->clear();
+    for (int c = 0; c < cells; ++c) grid->addItem(sweep.labelFor(c));
+    btSave->setEnabled(false);
+    status->setText(QString("Calculando %1 combinações...").arg(cells));
+
+    auto flag = std::make_shared<std::atomic<bool>>(false);
+    cancelFlag = flag;
+    QPointer<SweepDialog> self(this);
+    const cv::Mat src = image;
+    const double scale = previewScale;
+    const double srcScale = sourceScale;
+    const ParameterSweep job = sweep;
+    QThreadPool::globalInstance()->start([self, src, scale, srcScale, job, flag, id, cells]{
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = job.run(src, [self, id](int cell, const cv::Mat& result) {
+            const double f = std::min(1.0, double(kThumbSide) / std::max(result.cols, result.rows));
+            cv::Mat thumb;
+            cv::resize(result, thumb, cv::Size(), f, f, cv::INTER_AREA);
+            const QImage img = Filters::matToQImage(thumb);
+            QMetaObject::invokeMethod(qApp, [self, id, cell, thumb, img]{
+                if (!self || self->runId != id) return;
+                self->thumbs[cell] = thumb;
+                if (auto* item = self->grid->item(cell)) item->setIcon(QIcon(QPixmap::fromImage(img)));
+            }, Qt::QueuedConnection);
+        }, scale, [flag]{ return flag->load(); }, srcScale);
+        const qint64 ms = timer.elapsed();
+        QMetaObject::invokeMethod(qApp, [self, id, ok, ms, cells]{
+            if (!self || self->runId != id) return;
+            self->status->setText(ok ? QString("%1 combinações em %2 ms").arg(cells).arg(ms)
+                                     : QString("Varredura interrompida."));
+            self->btSave->setEnabled(ok);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SweepDialog::saveSheet()
+{
+    const auto out = QFileDialog::getSaveFileName(this, "Salvar folha de contatos", "varredura.png", "Imagens (*.png *.jpg *.jpeg *.bmp)");
+    if (out.isEmpty()) return;
+    QStringList labels;
+    for (int c = 0; c < sweep.cellCount(); ++c) labels << sweep.labelFor(c);
+    const cv::Mat sheet = ParameterSweep::contactSheet(thumbs, labels, sweep.columns(), kThumbSide);
+    if (!cv::imwrite(out.toStdString(), sheet))
+        QMessageBox::warning(this, "Erro", "Falha ao salvar a folha de contatos.");
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <QDialog>
+#include <QList>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "ParameterSweep.h"
+
+class QComboBox;
+class QDoubleSpinBox;
+class QLabel;
+class QListWidget;
+class QPushButton;
+
+// Sweeps up to two parameters of one stage and shows the grid as a contact
+// sheet that fills in as cells finish. Picking a cell (double click or
+// "Usar selecionada") accepts the dialog; chosen() is that stage's config.
+class SweepDialog : public QDialog {
+    Q_OBJECT
+public:
+    // `previewScale` < 1 runs the grid on a downscaled copy of `image`;
+    // `sourceScale` is the size of `image` relative to the full resolution.
+    SweepDialog(const cv::Mat& image, const QList<FilterConfig>& stages, int stage,
+                double previewScale, double sourceScale = 1.0, QWidget* parent = nullptr);
+    ~SweepDialog() override;
+
+    FilterConfig chosen() const;
+
+    static const int kThumbSide = 160;
+
+private slots:
+    void runSweep();
+    void saveSheet();
+
+private:
+    struct AxisRow {
+        QComboBox* param = nullptr;
+        QDoubleSpinBox* from = nullptr;
+        QDoubleSpinBox* to = nullptr;
+        QDoubleSpinBox* step = nullptr;
+    };
+
+    void resetRange(const AxisRow& row);
+    void cancelRun();
+
+    cv::Mat image;
+    QList<FilterConfig> stages;
+    int stage;
+    double previewScale;
+    double sourceScale;
+
+    AxisRow rows[2];
+    QListWidget* grid = nullptr;
+    QLabel* status = nullptr;
+    QPushButton* btSave = nullptr;
+
+    ParameterSweep sweep { {}, {} };
+    std::vector<cv::Mat> thumbs;
+    quint64 runId = 0;
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+};
@@ -0,0 +1,69 @@
+#include "ThumbnailCache.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+
+static const int kThumbnailQuality = 80;
+
+ThumbnailCache::ThumbnailCache(QObject* parent, QString directory)
+    : QObject(parent)
+    , dir(directory.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails"
+                              : std::move(directory))
+{
+}
+
+QString ThumbnailCache::fileFor(const QString& path) const {
+    const QFileInfo fi(path);
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    h.addData(fi.absoluteFilePath().toUtf8());
+    h.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    return dir + "/" + QString::fromLatin1(h.result().toHex()) + ".jpg";
+}
+
+QImage ThumbnailCache::cached(const QString& path) {
+    if (!QFileInfo::exists(path)) return QImage();
+    const QString file = fileFor(path);
+    auto it = memory.constFind(file);
+    if (it != memory.constEnd()) return it.value();
+    QImage img(file);
+    if (!img.isNull()) memory.insert(file, img);
+    return img;
+}
+
+void ThumbnailCache::request(const QStringList& paths) {
+    for (const auto& path : paths) {
+        if (inFlight.contains(path) || !cached(path).isNull() || !QFileInfo::exists(path)) continue;
+        inFlight.insert(path);
+        const QString file = fileFor(path);
+        const QString outDir = dir;
+        QPointer<ThumbnailCache> self(this);
+        QThreadPool::globalInstance()->start([self, path, file, outDir] {
+            QImageReader reader(path);
+            reader.setAutoTransform(true);
+            const QSize size = reader.size();
+            // JPEG readers decode straight at the scaled size.
+            if (size.isValid()) reader.setScaledSize(size.scaled(kSide, kSide, Qt::KeepAspectRatio));
+            QImage thumb = reader.read();
+            if (!thumb.isNull() && (thumb.width() > kSide || thumb.height() > kSide))
+                thumb = thumb.scaled(kSide, kSide, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            if (!thumb.isNull() && QDir().mkpath(outDir)) {
+                QSaveFile f(file);
+                if (f.open(QIODevice::WriteOnly) && thumb.save(&f, "JPG", kThumbnailQuality)) f.commit();
+            }
+            QMetaObject::invokeMethod(qApp, [self, path, file, thumb] {
+                if (!self) return;
+                self->inFlight.remove(path);
+                if (thumb.isNull()) return;
+                self->memory.insert(file, thumb);
+                emit self->thumbnailReady(path, thumb);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
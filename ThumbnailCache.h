@@ -0,0 +1,33 @@
+#pragma once
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+// Thumbnails for the recent-files menu. Each one is a small JPEG in the
+// cache directory named after sha1(absolute path + mtime), so a modified
+// file gets a fresh thumbnail. Missing thumbnails are generated on the
+// thread pool (decoding at reduced scale where the format allows) and
+// announced with thumbnailReady().
+class ThumbnailCache : public QObject {
+    Q_OBJECT
+public:
+    explicit ThumbnailCache(QObject* parent = nullptr, QString directory = QString());
+
+    // Memory or disk hit, else a null image.
+    QImage cached(const QString& path);
+    void request(const QStringList& paths);
+
+    static const int kSide = 96;
+
+signals:
+    void thumbnailReady(const QString& path, const QImage& thumbnail);
+
+private:
+    QString fileFor(const QString& path) const;
+
+    QString dir;
+    QHash<QString, QImage> memory; // keyed by fileFor()
+    QSet<QString> inFlight;
+};
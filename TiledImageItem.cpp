@@ -0,0 +1,109 @@
+#include "TiledImageItem.h"
+#include "Filters.h"
+#include "Profiler.h"
+
+#include <QCoreApplication>
+#include <QPainter>
+#include <QPointer>
+#include <QStyleOptionGraphicsItem>
+#include <QThreadPool>
+#include <cmath>
+
+static const int kTileSize = 512;
+// Levels stop once the whole image fits in one tile.
+static const int kMinLevelSide = kTileSize;
+static const int kTileCacheKiB = 96 * 1024;
+
+TiledImageItem::TiledImageItem(QGraphicsItem* parent)
+    : QGraphicsObject(parent)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    tiles.setMaxCost(kTileCacheKiB);
+}
+
+void TiledImageItem::setImage(const cv::Mat& image) {
+    prepareGeometryChange();
+    base = image;
+    levels.assign(1, base);
+    tiles.clear();
+    latestGeneration->store(++generation);
+    buildPyramid();
+    update();
+}
+
+void TiledImageItem::clear() {
+    setImage(cv::Mat());
+}
+
+void TiledImageItem::buildPyramid() {
+    if (base.empty() || std::max(base.cols, base.rows) <= kMinLevelSide) return;
+
+    const cv::Mat src = base;
+    const quint64 gen = generation;
+    const auto latest = latestGeneration;
+    QPointer<TiledImageItem> self(this);
+    QThreadPool::globalInstance()->start([self, src, gen, latest] {
+        IMAGELAB_TRACE_SCOPE("TiledImageItem::buildPyramid");
+        std::vector<cv::Mat> built { src };
+        while (std::max(built.back().cols, built.back().rows) > kMinLevelSide) {
+            if (latest->load() != gen) return;
+            cv::Mat next;
+            cv::resize(built.back(), next, cv::Size((built.back().cols + 1) / 2, (built.back().rows + 1) / 2),
+                       0, 0, cv::INTER_AREA);
+            built.push_back(next);
+        }
+        QMetaObject::invokeMethod(qApp, [self, gen, built] {
+            if (!self || self->generation != gen) return;
+            self->levels = built;
+            self->update();
+        }, Qt::QueuedConnection);
+    });
+}
+
+int TiledImageItem::levelFor(double lod) const {
+    // Use the smallest level that still has at least one texel per device
+    // pixel; SmoothPixmapTransform covers the remaining factor (< 2).
+    int level = lod > 0 ? int(std::floor(std::log2(1.0 / lod))) : 0;
+    return std::max(0, std::min(level, int(levels.size()) - 1));
+}
+
+const QPixmap& TiledImageItem::tile(int level, int tx, int ty) {
+    const quint64 key = (quint64(level) << 48) | (quint64(ty) << 24) | quint64(tx);
+    if (QPixmap* p = tiles.object(key)) return *p;
+
+    IMAGELAB_TRACE_SCOPE("QPixmap::fromImage (bloco)");
+    const cv::Mat& m = levels[level];
+    const cv::Rect r(tx * kTileSize, ty * kTileSize,
+                     std::min(kTileSize, m.cols - tx * kTileSize), std::min(kTileSize, m.rows - ty * kTileSize));
+    auto* pm = new QPixmap(QPixmap::fromImage(Filters::matToQImageShared(m(r))));
+    const int cost = std::max(1, int(qint64(pm->width()) * pm->height() * pm->depth() / 8 / 1024));
+    tiles.insert(key, pm, cost);
+    return *pm;
+}
+
+QRectF TiledImageItem::boundingRect() const {
+    return QRectF(0, 0, base.cols, base.rows);
+}
+
+void TiledImageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*) {
+    if (base.empty()) return;
+    IMAGELAB_TRACE_SCOPE("TiledImageItem::paint");
+
+    const int level = levelFor(option->levelOfDetailFromTransform(painter->worldTransform()));
+    const cv::Mat& m = levels[level];
+    const double fx = double(base.cols) / m.cols, fy = double(base.rows) / m.rows;
+
+    const QRectF exposed = option->exposedRect.intersected(boundingRect());
+    const int tx0 = std::max(0, int(exposed.left() / fx) / kTileSize);
+    const int ty0 = std::max(0, int(exposed.top() / fy) / kTileSize);
+    const int tx1 = std::min((m.cols - 1) / kTileSize, int(std::ceil(exposed.right() / fx)) / kTileSize);
+    const int ty1 = std::min((m.rows - 1) / kTileSize, int(std::ceil(exposed.bottom() / fy)) / kTileSize);
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const QPixmap& pm = tile(level, tx, ty);
+            const QRectF target(tx * kTileSize * fx, ty * kTileSize * fy, pm.width() * fx, pm.height() * fy);
+            painter->drawPixmap(target, pm, QRectF(pm.rect()));
+        }
+    }
+}
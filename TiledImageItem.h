@@ -0,0 +1,44 @@
+#pragma once
+#include <QGraphicsObject>
+#include <QCache>
+#include <QPixmap>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Scene item for large images. A mipmap pyramid (each level half the size
+// of the previous one) is built on the thread pool after setImage(); paint()
+// picks the level matching the current view transform and draws only the
+// tiles that intersect the exposed rect, so the cost of a frame depends on
+// the viewport, not on the image size. Until the pyramid is ready the full
+// resolution level is used. Builds for images replaced meanwhile stop
+// between levels (or before starting), so rapid updates do not pile up
+// stale work on the pool.
+//
+// Tiles wrap Mat ROIs without copying (Filters::matToQImageShared) and are
+// kept as pixmaps in a small LRU cache.
+class TiledImageItem : public QGraphicsObject {
+    Q_OBJECT
+public:
+    explicit TiledImageItem(QGraphicsItem* parent = nullptr);
+
+    void setImage(const cv::Mat& image);
+    void clear();
+    const cv::Mat& image() const { return base; }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    void buildPyramid();
+    int levelFor(double lod) const;
+    const QPixmap& tile(int level, int tx, int ty);
+
+    cv::Mat base;
+    std::vector<cv::Mat> levels; // levels[0] == base
+    quint64 generation = 0;
+    // Read by pending builds, which may outlive the item.
+    std::shared_ptr<std::atomic<quint64>> latestGeneration = std::make_shared<std::atomic<quint64>>(0);
+    QCache<quint64, QPixmap> tiles;
+};
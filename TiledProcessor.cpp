@@ -0,0 +1,345 @@
+#include "TiledProcessor.h"
+#include "FilterPipeline.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QTemporaryFile>
+#include <array>
+#include <cctype>
+#include <memory>
+#include <opencv2/imgcodecs.hpp>
+
+// Rough number of strip-sized 8-bit buffers alive at once while a stage
+// runs: input, output and the filters' own intermediates.
+static const int kBuffersPerStrip = 6;
+
+class TiledProcessor::StripSource {
+public:
+    virtual ~StripSource() = default;
+    // Fills `dst` with rows [y0, y1) as 8-bit BGR, or 8-bit single-channel
+    // for grayscale PGM sources.
+    virtual bool read(int y0, int y1, cv::Mat& dst) = 0;
+    int rows = 0;
+    int cols = 0;
+};
+
+class TiledProcessor::StripSink {
+public:
+    virtual ~StripSink() = default;
+    virtual bool write(const cv::Mat& strip, int y0) = 0;
+    virtual bool finish() = 0;
+};
+
+namespace {
+
+bool isPnm(const QString& path) {
+    const QString ext = QFileInfo(path).suffix().toLower();
+    return ext == "ppm" || ext == "pgm" || ext == "pnm";
+}
+
+bool parsePnmHeader(const QByteArray& head, int& cols, int& rows, int& channels, qint64& offset) {
+    if (head.size() < 2 || head[0] != 'P' || (head[1] != '5' && head[1] != '6')) return false;
+    int pos = 2;
+    long vals[3] = { 0, 0, 0 };
+    for (long& v : vals) {
+        while (pos < head.size()) {
+            if (std::isspace(uchar(head[pos]))) ++pos;
+            else if (head[pos] == '#') { while (pos < head.size() && head[pos] != '\n') ++pos; }
+            else break;
+        }
+        int digits = 0;
+        while (pos < head.size() && std::isdigit(uchar(head[pos]))) {
+            v = v * 10 + (head[pos] - '0');
+            ++pos;
+            ++digits;
+        }
+        if (!digits) return false;
+    }
+    if (pos >= head.size() || !std::isspace(uchar(head[pos]))) return false;
+    if (vals[0] <= 0 || vals[1] <= 0 || vals[2] != 255) return false;
+    cols = int(vals[0]);
+    rows = int(vals[1]);
+    channels = head[1] == '6' ? 3 : 1;
+    offset = pos + 1;
+    return true;
+}
+
+class PnmSource : public TiledProcessor::StripSource {
+public:
+    bool open(const QString& path) {
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        return parsePnmHeader(file.peek(4096), cols, rows, channels, dataOffset);
+    }
+
+    bool read(int y0, int y1, cv::Mat& dst) override {
+        const qint64 rowBytes = qint64(cols) * channels;
+        cv::Mat raw(y1 - y0, cols, CV_8UC(channels));
+        if (!file.seek(dataOffset + y0 * rowBytes)) return false;
+        const qint64 want = rowBytes * (y1 - y0);
+        if (file.read(reinterpret_cast<char*>(raw.data), want) != want) return false;
+        if (channels == 3) cv::cvtColor(raw, dst, cv::COLOR_RGB2BGR);
+        else dst = raw;
+        return true;
+    }
+
+private:
+    QFile file;
+    int channels = 3;
+    qint64 dataOffset = 0;
+};
+
+class SpilledSource : public TiledProcessor::StripSource {
+public:
+    bool open(const QString& path, qint64 memoryLimit, QString* error) {
+        // The decoder needs the whole image at once; refuse what would not
+        // fit in the limit instead of attempting the allocation.
+        const QSize size = QImageReader(path).size();
+        const qint64 decoded = qint64(size.width()) * size.height() * 3;
+        if (size.isValid() && decoded > memoryLimit) {
+            *error = QString("decodificar %1 exige a imagem inteira na memória (%2 MB, limite %3 MB); "
+                             "converta-a para PPM/PGM, que é lido em blocos")
+                         .arg(QFileInfo(path).fileName()).arg(decoded >> 20).arg(memoryLimit >> 20);
+            return false;
+        }
+        cv::Mat img = cv::imread(path.toStdString(), cv::IMREAD_COLOR);
+        if (img.empty() || !scratch.open()) {
+            *error = "falha ao decodificar a entrada";
+            return false;
+        }
+        rows = img.rows;
+        cols = img.cols;
+        rowBytes = qint64(cols) * img.elemSize();
+        for (int y = 0; y < rows; ++y) {
+            if (scratch.write(img.ptr<char>(y), rowBytes) != rowBytes) {
+                *error = "falha ao gravar o arquivo temporário";
+                return false;
+            }
+        }
+        img.release();
+        data = scratch.map(0, rowBytes * rows);
+        if (!data) *error = "falha ao mapear o arquivo temporário";
+        return data != nullptr;
+    }
+
+    bool read(int y0, int y1, cv::Mat& dst) override {
+        dst = cv::Mat(y1 - y0, cols, CV_8UC3, data + y0 * rowBytes);
+        return true;
+    }
+
+private:
+    QTemporaryFile scratch;
+    uchar* data = nullptr;
+    qint64 rowBytes = 0;
+};
+
+class PnmSink : public TiledProcessor::StripSink {
+public:
+    PnmSink(const QString& path, int rows) : rows(rows) { file.setFileName(path); }
+
+    bool write(const cv::Mat& strip, int) override {
+        if (!file.isOpen()) {
+            channels = strip.channels() == 1 ? 1 : 3;
+            if (!file.open(QIODevice::WriteOnly)) return false;
+            const QByteArray header = QString("P%1\n%2 %3\n255\n")
+                .arg(channels == 3 ? 6 : 5).arg(strip.cols).arg(rows).toLatin1();
+            if (file.write(header) != header.size()) return false;
+        }
+        cv::Mat out;
+        if (channels == 3) cv::cvtColor(strip, out, cv::COLOR_BGR2RGB);
+        else out = strip.isContinuous() ? strip : strip.clone();
+        const qint64 want = qint64(out.total()) * out.elemSize();
+        return file.write(reinterpret_cast<const char*>(out.data), want) == want;
+    }
+
+    bool finish() override { return file.isOpen() && file.flush(); }
+
+private:
+    QFile file;
+    int rows;
+    int channels = 3;
+};
+
+class SpilledSink : public TiledProcessor::StripSink {
+public:
+    SpilledSink(const QString& path, int rows) : path(path), rows(rows) {}
+
+    bool write(const cv::Mat& strip, int y0) override {
+        if (!data) {
+            type = strip.type();
+            cols = strip.cols;
+            rowBytes = qint64(cols) * strip.elemSize();
+            if (!scratch.open() || !scratch.resize(rowBytes * rows)) return false;
+            data = scratch.map(0, rowBytes * rows);
+            if (!data) return false;
+        }
+        if (strip.type() != type || strip.cols != cols) return false;
+        cv::Mat dst(strip.rows, cols, type, data + y0 * rowBytes);
+        strip.copyTo(dst);
+        return true;
+    }
+
+    bool finish() override {
+        if (!data) return false;
+        const cv::Mat whole(rows, cols, type, data);
+        return cv::imwrite(path.toStdString(), whole);
+    }
+
+private:
+    QString path;
+    QTemporaryFile scratch;
+    uchar* data = nullptr;
+    int rows;
+    int cols = 0;
+    int type = CV_8UC3;
+    qint64 rowBytes = 0;
+};
+
+void accumulateLuma(const cv::Mat& strip, std::array<quint64, 256>& hist) {
+    cv::Mat y;
+    if (strip.channels() == 1) {
+        y = strip;
+    } else {
+        cv::Mat ycrcb;
+        cv::cvtColor(strip, ycrcb, cv::COLOR_BGR2YCrCb);
+        cv::extractChannel(ycrcb, y, 0);
+    }
+    for (int r = 0; r < y.rows; ++r) {
+        const uchar* p = y.ptr<uchar>(r);
+        for (int c = 0; c < y.cols; ++c) ++hist[p[c]];
+    }
+}
+
+// Same mapping as cv::equalizeHist, built from a histogram gathered over
+// every strip instead of a single in-memory image.
+cv::Mat equalizeLut(const std::array<quint64, 256>& hist) {
+    cv::Mat lut(1, 256, CV_8U, cv::Scalar(0));
+    quint64 total = 0;
+    for (quint64 h : hist) total += h;
+    int i = 0;
+    while (i < 256 && !hist[i]) ++i;
+    if (i == 256) return lut;
+    if (hist[i] == total) {
+        lut.setTo(i);
+        return lut;
+    }
+    const double scale = 255.0 / double(total - hist[i]);
+    quint64 sum = 0;
+    for (++i; i < 256; ++i) {
+        sum += hist[i];
+        lut.at<uchar>(i) = cv::saturate_cast<uchar>(sum * scale);
+    }
+    return lut;
+}
+
+cv::Mat applyEqualizeLut(const cv::Mat& src, const cv::Mat& lut) {
+    cv::Mat out;
+    if (src.channels() == 1) {
+        cv::LUT(src, lut, out);
+        return out;
+    }
+    cv::Mat ycrcb;
+    cv::cvtColor(src, ycrcb, cv::COLOR_BGR2YCrCb);
+    std::vector<cv::Mat> ch;
+    cv::split(ycrcb, ch);
+    cv::LUT(ch[0], lut, ch[0]);
+    cv::merge(ch, ycrcb);
+    cv::cvtColor(ycrcb, out, cv::COLOR_YCrCb2BGR);
+    return out;
+}
+
+} // namespace
+
+bool TiledProcessor::supports(const QList<FilterConfig>& stages, QString* why) {
+    for (const auto& st : stages) {
+        if (FilterPipeline::isFrequencyDomain(st)) {
+            if (why) *why = QString("%1 depende da imagem inteira e não pode ser processado em blocos").arg(st.name);
+            return false;
+        }
+    }
+    return true;
+}
+
+int TiledProcessor::haloForPrefix(int stageCount) const {
+    int halo = 0;
+    for (int i = 0; i < stageCount; ++i) halo += FilterPipeline::haloFor(stages[i]);
+    return halo;
+}
+
+cv::Mat TiledProcessor::runStages(const cv::Mat& in, int stageCount) const {
+    cv::Mat cur = in;
+    for (int i = 0; i < stageCount; ++i) {
+        auto lut = equalizeLuts.constFind(i);
+        cur = lut != equalizeLuts.constEnd() ? applyEqualizeLut(cur, *lut)
+                                             : FilterPipeline::applyStage(cur, stages[i]);
+    }
+    return cur;
+}
+
+bool TiledProcessor::streamStrips(StripSource& src, int stageCount, const StripFn& fn) {
+    const int halo = haloForPrefix(stageCount);
+    for (int y0 = 0; y0 < src.rows; y0 += stripRows) {
+        const int y1 = qMin(src.rows, y0 + stripRows);
+        const int a = qMax(0, y0 - halo);
+        const int b = qMin(src.rows, y1 + halo);
+        cv::Mat in;
+        if (!src.read(a, b, in)) return false;
+        const cv::Mat out = runStages(in, stageCount);
+        if (!fn(out.rowRange(y0 - a, y1 - a), y0)) return false;
+    }
+    return true;
+}
+
+bool TiledProcessor::process(const QString& inPath, const QString& outPath,
+                             const QList<FilterConfig>& stageList, QString* error) {
+    auto fail = [error](const QString& msg) {
+        if (error) *error = msg;
+        return false;
+    };
+    if (!supports(stageList, error)) return false;
+    stages = stageList;
+    equalizeLuts.clear();
+
+    std::unique_ptr<StripSource> src;
+    if (isPnm(inPath)) {
+        auto pnm = std::make_unique<PnmSource>();
+        if (pnm->open(inPath)) src = std::move(pnm);
+    }
+    if (!src) {
+        auto spilled = std::make_unique<SpilledSource>();
+        QString why;
+        if (!spilled->open(inPath, memoryLimit, &why)) return fail(why);
+        src = std::move(spilled);
+    }
+
+    const int halo = haloForPrefix(stages.size());
+    const qint64 bytesPerRow = qint64(src->cols) * 3 * kBuffersPerStrip;
+    // The halo comes out of the memory budget, not out of the image height.
+    const qint64 budgetRows = memoryLimit / bytesPerRow - 2 * halo;
+    if (budgetRows < 1) return fail("limite de memória insuficiente para a largura da imagem e o halo dos filtros");
+    stripRows = int(qMin<qint64>(src->rows, budgetRows));
+
+    // Global histogram equalization needs the luma histogram of its whole
+    // input: gather it in a streaming pre-pass over the preceding stages.
+    for (int i = 0; i < stages.size(); ++i) {
+        if (stages[i].name != "Equalização de Histograma") continue;
+        std::array<quint64, 256> hist {};
+        const bool ok = streamStrips(*src, i, [&hist](const cv::Mat& centre, int) {
+            accumulateLuma(centre, hist);
+            return true;
+        });
+        if (!ok) return fail("falha ao ler a entrada");
+        equalizeLuts.insert(i, equalizeLut(hist));
+    }
+
+    std::unique_ptr<StripSink> sink;
+    if (isPnm(outPath)) sink = std::make_unique<PnmSink>(outPath, src->rows);
+    else sink = std::make_unique<SpilledSink>(outPath, src->rows);
+
+    const bool ok = streamStrips(*src, stages.size(), [&sink](const cv::Mat& centre, int y0) {
+        return sink->write(centre, y0);
+    });
+    if (!ok || !sink->finish()) return fail("falha ao gravar a saída");
+    return true;
+}
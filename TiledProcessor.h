@@ -0,0 +1,47 @@
+#pragma once
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <functional>
+#include <opencv2/opencv.hpp>
+
+#include "SessionStore.h"
+
+// Streams an image file through a filter pipeline in horizontal strips so
+// that the working set stays below a memory ceiling, for images that do not
+// fit in RAM. Each strip is read with enough halo rows for every stage's
+// neighbourhood and only its centre is written out. The output matches the
+// whole-image result except for Canny, whose hysteresis may keep or drop a
+// weak edge differently where it crosses a strip boundary.
+//
+// Binary PPM/PGM files are read and written strip by strip, so only they
+// can exceed RAM. Other formats are decoded once and spilled to a
+// memory-mapped scratch file; the decoder itself needs the full image, so
+// they are refused when their decoded size exceeds the memory limit. They
+// are encoded from a mapped buffer.
+class TiledProcessor {
+public:
+    explicit TiledProcessor(qint64 memoryLimitBytes = qint64(512) << 20) : memoryLimit(memoryLimitBytes) {}
+
+    static bool supports(const QList<FilterConfig>& stages, QString* why = nullptr);
+
+    bool process(const QString& inPath, const QString& outPath,
+                 const QList<FilterConfig>& stages, QString* error = nullptr);
+
+    int lastStripRows() const { return stripRows; }
+
+    class StripSource;
+    class StripSink;
+
+private:
+    using StripFn = std::function<bool(const cv::Mat& centre, int y0)>;
+
+    bool streamStrips(StripSource& src, int stageCount, const StripFn& fn);
+    cv::Mat runStages(const cv::Mat& in, int stageCount) const;
+    int haloForPrefix(int stageCount) const;
+
+    qint64 memoryLimit;
+    QList<FilterConfig> stages;
+    QMap<int, cv::Mat> equalizeLuts;
+    int stripRows = 0;
+};
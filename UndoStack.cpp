@@ -0,0 +1,190 @@
+#include "UndoStack.h"
+#include <QCoreApplication>
+#include <QPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstdlib>
+#include <opencv2/imgcodecs.hpp>
+
+// Fast PNG setting: undo states favour encode speed over size.
+static const int kPngCompression = 1;
+
+static qint64 bytesOf(const cv::Mat& m) {
+    return qint64(m.total() * m.elemSize());
+}
+
+UndoStack::UndoStack(QObject* parent, qint64 budget)
+    : QObject(parent)
+    , budgetBytes(budget)
+{
+}
+
+void UndoStack::record(const QByteArray& key, const State& state, const cv::Mat& result) {
+    if (cursor >= 0 && entries[cursor].key == key) {
+        Entry& cur = entries[cursor];
+        if (cur.result.empty() && !result.empty()) {
+            cur.result = result;
+            cur.png.clear();
+            enforceBudget();
+        }
+        cur.state = state;
+        return;
+    }
+    while (entries.size() > cursor + 1) entries.removeLast();
+    Entry e;
+    e.id = nextId++;
+    e.key = key;
+    e.state = state;
+    e.result = result;
+    entries.push_back(e);
+    cursor = entries.size() - 1;
+    enforceBudget();
+    emit changed();
+}
+
+bool UndoStack::undo(State& state, cv::Mat& result) {
+    return canUndo() && step(cursor - 1, state, result);
+}
+
+bool UndoStack::redo(State& state, cv::Mat& result) {
+    return canRedo() && step(cursor + 1, state, result);
+}
+
+bool UndoStack::step(int to, State& state, cv::Mat& result) {
+    cursor = to;
+    Entry& e = entries[cursor];
+    if (e.result.empty() && !e.png.isEmpty()) {
+        const std::vector<uchar> buf(e.png.begin(), e.png.end());
+        e.result = cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+        if (!e.result.empty()) e.png.clear();
+    }
+    state = e.state;
+    result = e.result;
+    enforceBudget();
+    emit changed();
+    return true;
+}
+
+UndoStack::History UndoStack::take() {
+    History h;
+    h.entries = std::move(entries);
+    h.cursor = cursor;
+    // Compressions still running find nothing to update; the entries keep
+    // their Mats and may be queued again once restored.
+    for (Entry& e : h.entries) e.compressing = false;
+    entries.clear();
+    cursor = -1;
+    emit changed();
+    return h;
+}
+
+void UndoStack::restore(History history) {
+    entries = std::move(history.entries);
+    cursor = history.cursor;
+    enforceBudget();
+    emit changed();
+}
+
+void UndoStack::History::dropPixels() {
+    for (Entry& e : entries) {
+        e.result.release();
+        e.png.clear();
+    }
+}
+
+void UndoStack::clear() {
+    entries.clear();
+    cursor = -1;
+    emit changed();
+}
+
+void UndoStack::setBudget(qint64 bytes) {
+    budgetBytes = bytes;
+    enforceBudget();
+}
+
+qint64 UndoStack::usageOf(const QList<Entry>& entries) {
+    // Consecutive states often share a buffer (and the viewer holds it
+    // anyway); count each buffer once.
+    QSet<const uchar*> seen;
+    qint64 total = 0;
+    for (const auto& e : entries) {
+        if (!e.result.empty() && !seen.contains(e.result.datastart)) {
+            seen.insert(e.result.datastart);
+            total += bytesOf(e.result);
+        }
+        total += e.png.size();
+    }
+    return total;
+}
+
+UndoStack::Stats UndoStack::stats() const {
+    Stats s;
+    s.entries = entries.size();
+    for (const auto& e : entries) {
+        if (!e.result.empty()) ++s.resident;
+        else if (!e.png.isEmpty()) ++s.compressed;
+        else ++s.dropped;
+    }
+    s.bytes = usage();
+    s.budgetBytes = budgetBytes;
+    return s;
+}
+
+void UndoStack::enforceBudget() {
+    qint64 used = usage();
+    if (used <= budgetBytes) return;
+
+    // Farthest from the cursor first; the current state is never touched.
+    QList<int> order;
+    for (int i = 0; i < entries.size(); ++i)
+        if (i != cursor) order.push_back(i);
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return std::abs(a - cursor) > std::abs(b - cursor);
+    });
+
+    // Compression finishes later; count the Mat as gone so only as many
+    // entries as needed are queued, including those queued by earlier calls.
+    for (int i : order) {
+        if (used <= budgetBytes) return;
+        Entry& e = entries[i];
+        if (e.result.empty()) continue;
+        used -= bytesOf(e.result);
+        if (!e.compressing) compress(e);
+    }
+    for (int i : order) {
+        if (used <= budgetBytes) return;
+        Entry& e = entries[i];
+        if (e.png.isEmpty()) continue;
+        used -= e.png.size();
+        e.png.clear();
+    }
+}
+
+void UndoStack::compress(Entry& e) {
+    e.compressing = true;
+    const quint64 id = e.id;
+    const cv::Mat img = e.result;
+    QPointer<UndoStack> self(this);
+    QThreadPool::globalInstance()->start([self, id, img] {
+        std::vector<uchar> buf;
+        const bool ok = cv::imencode(".png", img, buf, { cv::IMWRITE_PNG_COMPRESSION, kPngCompression });
+        const QByteArray png = ok ? QByteArray(reinterpret_cast<const char*>(buf.data()), int(buf.size())) : QByteArray();
+        QMetaObject::invokeMethod(qApp, [self, id, png] {
+            if (!self) return;
+            for (int i = 0; i < self->entries.size(); ++i) {
+                Entry& e = self->entries[i];
+                if (e.id != id) continue;
+                e.compressing = false;
+                // Stepped back to meanwhile: keep the pixels at hand.
+                if (i == self->cursor || png.isEmpty()) break;
+                e.png = png;
+                e.result.release();
+                self->enforceBudget();
+                emit self->changed();
+                break;
+            }
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <opencv2/opencv.hpp>
+
+#include "SessionStore.h"
+
+// Undo/redo over full-resolution results. Every state records the stage
+// list that produced it, so the pixels are optional: results are shared
+// (never copied) while the stack fits its memory budget; past the budget the
+// states farthest from the cursor are PNG-compressed on the thread pool and,
+// if that is still too much, dropped and recomputed from their stages when
+// stepped back to.
+class UndoStack : public QObject {
+    Q_OBJECT
+public:
+    struct State {
+        QList<FilterConfig> stages;
+        int currentStage = 0;
+        QString label;
+    };
+
+private:
+    struct Entry {
+        quint64 id = 0;
+        QByteArray key;
+        State state;
+        cv::Mat result;
+        QByteArray png;
+        bool compressing = false;
+    };
+
+public:
+    struct Stats {
+        int entries = 0;
+        int resident = 0;   // held as shared Mats
+        int compressed = 0; // held as PNG
+        int dropped = 0;    // only the stages; recomputed on demand
+        qint64 bytes = 0;
+        qint64 budgetBytes = 0;
+    };
+
+    explicit UndoStack(QObject* parent = nullptr, qint64 budgetBytes = qint64(512) << 20);
+
+    // `key` identifies the result (ResultCache::keyFor at scale 1). A state
+    // equal to the current one only fills in its missing pixels; anything
+    // else discards the redo branch and becomes the new current state.
+    void record(const QByteArray& key, const State& state, const cv::Mat& result);
+
+    bool canUndo() const { return cursor > 0; }
+    bool canRedo() const { return cursor + 1 < entries.size(); }
+    // Move the cursor and return the state to restore. `result` is empty
+    // when the pixels were dropped and must be recomputed.
+    bool undo(State& state, cv::Mat& result);
+    bool redo(State& state, cv::Mat& result);
+    QString undoLabel() const { return canUndo() ? entries[cursor].state.label : QString(); }
+    QString redoLabel() const { return canRedo() ? entries[cursor + 1].state.label : QString(); }
+
+    // The states of one document, set aside while another one is active.
+    class History {
+    public:
+        qint64 bytes() const { return UndoStack::usageOf(entries); }
+        // Keeps only the stages; the pixels are recomputed when stepped to.
+        void dropPixels();
+    private:
+        friend class UndoStack;
+        QList<Entry> entries;
+        int cursor = -1;
+    };
+    // take() leaves the stack empty; restore() replaces its contents.
+    History take();
+    void restore(History history);
+
+    void clear();
+    void setBudget(qint64 bytes);
+    Stats stats() const;
+
+signals:
+    void changed();
+
+private:
+    bool step(int to, State& state, cv::Mat& result);
+    static qint64 usageOf(const QList<Entry>& entries);
+    qint64 usage() const { return usageOf(entries); }
+    void enforceBudget();
+    void compress(Entry& e);
+
+    QList<Entry> entries;
+    int cursor = -1;
+    quint64 nextId = 1;
+    qint64 budgetBytes;
+};
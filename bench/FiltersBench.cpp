@@ -0,0 +1,219 @@
+// Microbenchmark for every Filters:: function.
+//
+//   ImageLabQtBench [--format csv|json] [--reps N] [--threads 1,8] [--max-width W] [--filter name]
+//
+// Inputs are synthetic (smooth structure plus noise) so results are
+// reproducible across machines; output goes to stdout. Rows for the
+// recursive Gaussian also report its error against the FIR kernel.
+#include "../Filters.h"
+#include "../PointOps.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace {
+
+struct Result {
+    QString function;
+    QString params;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    int threads = 0;
+    int reps = 0;
+    double minMs = 0;
+    double medianMs = 0;
+    double meanMs = 0;
+    double maxAbsErr = -1; // < 0: no accuracy reference for this case
+    double psnr = -1;
+};
+
+cv::Mat syntheticImage(int w, int h, int channels) {
+    cv::Mat img(h, w, CV_8UC3);
+    for (int y = 0; y < h; ++y) {
+        auto* p = img.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < w; ++x)
+            p[x] = cv::Vec3b(uchar(x * 255 / w), uchar(y * 255 / h), uchar((x + y) & 255));
+    }
+    cv::RNG rng(12345);
+    for (int i = 0; i < 64; ++i) {
+        cv::circle(img, { rng.uniform(0, w), rng.uniform(0, h) }, rng.uniform(4, std::max(5, w / 8)),
+                   cv::Scalar(rng.uniform(0, 255), rng.uniform(0, 255), rng.uniform(0, 255)), -1);
+    }
+    cv::Mat noise(h, w, CV_8UC3);
+    rng.fill(noise, cv::RNG::NORMAL, 0, 12);
+    img += noise;
+    if (channels == 1) cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
+    return img;
+}
+
+Result measure(const QString& function, const QString& params, const cv::Mat& input,
+               int threads, int reps, const std::function<void()>& fn) {
+    fn(); // warm-up: first-touch allocations, OpenCL/IPP dispatch, caches
+    std::vector<double> ms;
+    ms.reserve(reps);
+    for (int i = 0; i < reps; ++i) {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double v : ms) sum += v;
+
+    Result r;
+    r.function = function;
+    r.params = params;
+    r.width = input.cols;
+    r.height = input.rows;
+    r.channels = input.channels();
+    r.threads = threads;
+    r.reps = reps;
+    r.minMs = ms.front();
+    r.medianMs = ms[ms.size() / 2];
+    r.meanMs = sum / ms.size();
+    return r;
+}
+
+void compareTo(Result& r, const cv::Mat& out, const cv::Mat& reference) {
+    cv::Mat diff;
+    cv::absdiff(out, reference, diff);
+    double maxErr = 0;
+    cv::minMaxLoc(diff.reshape(1), nullptr, &maxErr);
+    r.maxAbsErr = maxErr;
+    r.psnr = cv::PSNR(out, reference);
+}
+
+double mpixPerSec(const Result& r) {
+    return r.medianMs > 0 ? (double(r.width) * r.height / 1e6) / (r.medianMs / 1000.0) : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ImageLabQt filter microbenchmarks");
+    parser.addHelpOption();
+    parser.addOption({ "format", "csv or json.", "fmt", "csv" });
+    parser.addOption({ "reps", "Timed repetitions per case.", "n", "5" });
+    parser.addOption({ "threads", "Comma-separated OpenCV thread counts.", "list",
+                       QString("1,%1").arg(QThread::idealThreadCount()) });
+    parser.addOption({ "max-width", "Skip sizes wider than this.", "w", "7680" });
+    parser.addOption({ "filter", "Only run functions whose name contains this.", "name" });
+    parser.process(app);
+
+    const bool json = parser.value("format") == "json";
+    const int reps = std::max(1, parser.value("reps").toInt());
+    const int maxWidth = parser.value("max-width").toInt();
+    const QString only = parser.value("filter");
+    std::vector<int> threadCounts;
+    for (const auto& t : parser.value("threads").split(',', Qt::SkipEmptyParts))
+        threadCounts.push_back(std::max(1, t.toInt()));
+
+    const std::vector<cv::Size> sizes = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 },
+                                          { 3840, 2160 }, { 7680, 4320 } };
+    const std::vector<int> ksizes = { 3, 5, 7, 9, 15, 31, 51, 99 };
+
+    std::vector<Result> results;
+    auto run = [&](const QString& fn, const QString& params, const cv::Mat& in, int threads,
+                   const std::function<void()>& body) {
+        if (!only.isEmpty() && !fn.contains(only)) return;
+        results.push_back(measure(fn, params, in, threads, reps, body));
+    };
+
+    for (int threads : threadCounts) {
+        cv::setNumThreads(threads);
+        for (const auto& sz : sizes) {
+            if (sz.width > maxWidth) continue;
+            for (int channels : { 1, 3 }) {
+                const cv::Mat src = syntheticImage(sz.width, sz.height, channels);
+                cv::Mat out;
+                run("toGrayscale", "", src, threads, [&]{ out = Filters::toGrayscale(src); });
+                if (channels == 3)
+                    run("equalizeHistColor", "", src, threads, [&]{ out = Filters::equalizeHistColor(src); });
+                for (int k : ksizes) {
+                    run("gaussianBlur", QString("ksize=%1").arg(k), src, threads,
+                        [&]{ out = Filters::gaussianBlur(src, k, 0.0); });
+                }
+                for (double sigma : { 2.0, 4.0, 8.0, 16.0, 32.0 }) {
+                    const int k = 2 * int(std::ceil(4.0 * sigma)) + 1;
+                    const QString params = QString("sigma=%1 ksize=%2").arg(sigma).arg(k);
+                    cv::Mat fir;
+                    run("gaussianBlurFIR", params, src, threads,
+                        [&]{ cv::GaussianBlur(src, fir, cv::Size(k, k), sigma); });
+                    run("gaussianBlurRecursive", params, src, threads,
+                        [&]{ out = Filters::gaussianBlurRecursive(src, sigma); });
+                    if (!results.empty() && results.back().function == "gaussianBlurRecursive"
+                            && !fir.empty() && !out.empty())
+                        compareTo(results.back(), out, fir);
+                }
+                run("canny", "low=50 high=150", src, threads, [&]{ out = Filters::canny(src, 50, 150); });
+                run("brightnessContrast", "b=20 c=1.2", src, threads,
+                    [&]{ out = Filters::brightnessContrast(src, 20, 1.2); });
+                run("gammaCorrection", "g=1.8", src, threads, [&]{ out = Filters::gammaCorrection(src, 1.8); });
+                const PointOpChain stack = PointOpChain().brightnessContrast(20, 1.2).gamma(1.8).invert().threshold(100);
+                run("pointOpChain", "bc+gamma+invert+threshold", src, threads, [&]{ out = stack.apply(src); });
+                run("fftMagnitudeSpectrum", "", src, threads, [&]{ out = Filters::fftMagnitudeSpectrum(src); });
+
+                QImage q;
+                run("matToQImage", "", src, threads, [&]{ q = Filters::matToQImage(src); });
+                const QImage qin = Filters::matToQImage(src);
+                run("qImageToMat", "", src, threads, [&]{ out = Filters::qImageToMat(qin); });
+            }
+        }
+    }
+
+    QTextStream os(stdout);
+    if (json) {
+        QJsonArray arr;
+        for (const auto& r : results) {
+            QJsonObject o;
+            o["function"] = r.function;
+            o["params"] = r.params;
+            o["width"] = r.width;
+            o["height"] = r.height;
+            o["channels"] = r.channels;
+            o["threads"] = r.threads;
+            o["reps"] = r.reps;
+            o["min_ms"] = r.minMs;
+            o["median_ms"] = r.medianMs;
+            o["mean_ms"] = r.meanMs;
+            o["mpix_per_s"] = mpixPerSec(r);
+            if (r.maxAbsErr >= 0) {
+                o["max_abs_err"] = r.maxAbsErr;
+                o["psnr_db"] = r.psnr;
+            }
+            arr.append(o);
+        }
+        QJsonObject root;
+        root["opencv"] = QString::fromStdString(cv::getVersionString());
+        root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["results"] = arr;
+        os << QJsonDocument(root).toJson(QJsonDocument::Indented);
+    } else {
+        os << "function,params,width,height,channels,threads,reps,min_ms,median_ms,mean_ms,mpix_per_s,max_abs_err,psnr_db\n";
+        for (const auto& r : results) {
+            os << r.function << ',' << r.params << ',' << r.width << ',' << r.height << ','
+               << r.channels << ',' << r.threads << ',' << r.reps << ','
+               << QString::number(r.minMs, 'f', 3) << ',' << QString::number(r.medianMs, 'f', 3) << ','
+               << QString::number(r.meanMs, 'f', 3) << ',' << QString::number(mpixPerSec(r), 'f', 2) << ',';
+            if (r.maxAbsErr >= 0) os << r.maxAbsErr << ',' << QString::number(r.psnr, 'f', 2);
+            else os << ',';
+            os << '\n';
+        }
+    }
+    return 0;
+}
@@ -1,9 +1,18 @@
 #include "mainwindow.h"
+#include "BatchRunner.h"
+#include "MatPool.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+    MatPool::installCountingAllocator();
+    if (BatchRunner::isRequested(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        return BatchRunner::main(a.arguments());
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
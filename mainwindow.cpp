@@ -1,45 +1,109 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "Filters.h"
+#include "TiledProcessor.h"
+#include "Profiler.h"
+#include "SweepDialog.h"
+#include "ExportDialog.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QSplitter>
 #include <QFormLayout>
 #include <QVBoxLayout>
-#include <QGraphicsPixmapItem>
 #include <QAction>
+#include <QKeySequence>
 #include <QDateTime>
 #include <QMenu>
 #include <QStyle>
 #include <QFont>
 #include <QGraphicsTextItem>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QApplication>
+#include <QThreadPool>
+#include <QPointer>
+#include <QInputDialog>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QScrollBar>
+#include <cmath>
+
+// Below this size a full-resolution pass is already interactive.
+static const double kPreviewMinPixels = 4e6;
+static const int kRefineDelayMs = 350;
+// Zoomed in this far (visible part of the image below this fraction), only
+// the visible region is rendered, padded by kRegionMargin of its size on
+// every side so short pans need no new render.
+static const double kRegionMaxFraction = 0.35;
+static const double kRegionMargin = 0.25;
+static const int kPanDelayMs = 80;
+static const qint64 kTiledMemoryLimit = qint64(512) << 20;
+static const int kDefaultResultCacheMB = 256;
+static const int kDefaultDecodedCacheMB = 2048;
+static const int kDefaultUndoMB = 512;
+static const int kDefaultDocumentsMB = 1536;
+static const int kLatencyWindow = 20;
+// Longer side of the copy a parameter sweep runs on.
+static const int kSweepPreviewSide = 1024;
 
 static QString nowIso() {
     return QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
 }
 
+static ExportQueue::EncoderOptions exportOptionsFromJson(const QJsonObject& o) {
+    ExportQueue::EncoderOptions e;
+    e.pngCompression = o.value("pngCompression").toInt(e.pngCompression);
+    e.jpegQuality = o.value("jpegQuality").toInt(e.jpegQuality);
+    e.jpegProgressive = o.value("jpegProgressive").toBool(e.jpegProgressive);
+    e.webpQuality = o.value("webpQuality").toInt(e.webpQuality);
+    e.webpLossless = o.value("webpLossless").toBool(e.webpLossless);
+    e.tiffCompression = o.value("tiffCompression").toInt(e.tiffCompression);
+    return e;
+}
+
+static QJsonObject exportOptionsToJson(const ExportQueue::EncoderOptions& e) {
+    QJsonObject o;
+    o["pngCompression"] = e.pngCompression;
+    o["jpegQuality"] = e.jpegQuality;
+    o["jpegProgressive"] = e.jpegProgressive;
+    o["webpQuality"] = e.webpQuality;
+    o["webpLossless"] = e.webpLossless;
+    o["tiffCompression"] = e.tiffCompression;
+    return o;
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    resultCache.setBudget(qint64(session.loadSetting("resultCacheMB", kDefaultResultCacheMB).toInt()) << 20);
+    decodedCache = std::make_shared<DecodedCache>(
+        QString(), qint64(session.loadSetting("decodedCacheMB", kDefaultDecodedCacheMB).toInt()) << 20);
+    doc.setDecodedCache(decodedCache);
+    thumbnails = new ThumbnailCache(this);
+    undoStack = new UndoStack(this, qint64(session.loadSetting("undoMB", kDefaultUndoMB).toInt()) << 20);
+    exportQueue = new ExportQueue(this);
+    documents = new DocumentStore(this, qint64(session.loadSetting("documentsMB", kDefaultDocumentsMB).toInt()) << 20);
+    setupFilterWorker();
     setupUiExtras();
     buildMenusAndToolbar();
 
     QString lastPath;
-    if (session.load(lastPath, cfg)) {
-        cfg.name = mapLegacyFilterName(cfg.name);
+    QList<FilterConfig> loaded;
+    if (session.load(lastPath, loaded)) {
+        setStages(loaded);
         recentFiles = session.loadRecent();
         rebuildOpenRecentMenu();
 
-        if (!lastPath.isEmpty() && doc.load(lastPath)) {
-            cbFilter->setCurrentText(cfg.name);
+        if (!lastPath.isEmpty() && loadDocument(lastPath)) {
             applyFilter();
             loadHistoryForCurrentImage();
         } else {
             refreshViews();
         }
+        prefetchRecent();
     } else {
         refreshViews();
     }
@@ -47,20 +111,117 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    filterWorker->cancelAll();
+    filterThread->quit();
+    filterThread->wait();
     delete ui;
 }
 
-QString MainWindow::mapLegacyFilterName(const QString& legacy) const {
-    static QMap<QString, QString> m = {
-        {"None", "Nenhum"},
-        {"Grayscale", "Escala de Cinza"},
-        {"EqualizeHist", "Equalização de Histograma"},
-        {"GaussianBlur", "Desfoque Gaussiano"},
-        {"Canny", "Canny"},
-        {"BrightnessContrast", "Brilho/Contraste"},
-        {"FFT", "Espectro (FFT)"}
-    };
-    return m.value(legacy, legacy);
+void MainWindow::setupFilterWorker()
+{
+    filterThread = new QThread(this);
+    filterWorker = new FilterWorker;
+    filterWorker->moveToThread(filterThread);
+    connect(filterThread, &QThread::finished, filterWorker, &QObject::deleteLater);
+    connect(filterWorker, &FilterWorker::finished, this, &MainWindow::onFilterFinished);
+    filterThread->start();
+}
+
+void MainWindow::setStages(const QList<FilterConfig>& loaded)
+{
+    stages = loaded;
+    for (auto& st : stages) st.name = SessionStore::mapLegacyFilterName(st.name);
+    if (stages.isEmpty()) stages.push_back(FilterConfig{ "Nenhum" });
+    currentStage = 0;
+    cfg = stages.first();
+    syncControlsFromConfig();
+    rebuildStageList();
+}
+
+void MainWindow::syncControlsFromConfig()
+{
+    const QSignalBlocker b0(cbFilter), b1(sbKsize), b2(dsSigma), b3(sbLow), b4(sbHigh), b5(sBrightness), b6(dsContrast),
+                         b7(dsGamma), b8(sbThreshold), b9(cbFreqShape), b10(dsCutoff), b11(sbOrder),
+                         b12(sbNotchU), b13(sbNotchV), b14(dsNotchRadius);
+    cbFilter->setCurrentText(cfg.name);
+    sbKsize->setValue(cfg.ksize);
+    dsSigma->setValue(cfg.sigma);
+    sbLow->setValue(cfg.lowThresh);
+    sbHigh->setValue(cfg.highThresh);
+    sBrightness->setValue(cfg.brightness);
+    lbBrightness->setText(QString("Brilho: %1").arg(cfg.brightness));
+    dsContrast->setValue(cfg.contrast);
+    dsGamma->setValue(cfg.gamma);
+    sbThreshold->setValue(cfg.threshold);
+    cbFreqShape->setCurrentText(cfg.freqShape);
+    dsCutoff->setValue(cfg.cutoff);
+    sbOrder->setValue(cfg.order);
+    sbNotchU->setValue(cfg.notchU);
+    sbNotchV->setValue(cfg.notchV);
+    dsNotchRadius->setValue(cfg.notchRadius);
+    updateControlsVisibility();
+}
+
+void MainWindow::rebuildStageList()
+{
+    const QSignalBlocker block(stageList);
+    stageList->clear();
+    for (int i = 0; i < stages.size(); ++i)
+        stageList->addItem(QString("%1. %2").arg(i + 1).arg(stages[i].name));
+    stageList->setCurrentRow(currentStage);
+}
+
+void MainWindow::selectStage(int row)
+{
+    if (row < 0 || row >= stages.size() || row == currentStage) return;
+    stages[currentStage] = cfg;
+    currentStage = row;
+    cfg = stages[row];
+    syncControlsFromConfig();
+    detailsLabel->setText(filterSummaryText());
+}
+
+void MainWindow::addStage()
+{
+    stages[currentStage] = cfg;
+    currentStage += 1;
+    stages.insert(currentStage, FilterConfig{ "Nenhum" });
+    cfg = stages[currentStage];
+    syncControlsFromConfig();
+    rebuildStageList();
+    applyFilter();
+}
+
+void MainWindow::removeStage()
+{
+    if (stages.size() <= 1) return;
+    stages.removeAt(currentStage);
+    currentStage = qMin(currentStage, stages.size() - 1);
+    cfg = stages[currentStage];
+    syncControlsFromConfig();
+    rebuildStageList();
+    applyFilter();
+    if (doc.hasImage()) pushHistory(QString("Etapa removida (%1 restantes)").arg(stages.size()));
+}
+
+void MainWindow::moveStageUp()
+{
+    if (currentStage <= 0) return;
+    stages[currentStage] = cfg;
+    stages.swapItemsAt(currentStage, currentStage - 1);
+    currentStage -= 1;
+    rebuildStageList();
+    applyFilter();
+}
+
+void MainWindow::moveStageDown()
+{
+    if (currentStage >= stages.size() - 1) return;
+    stages[currentStage] = cfg;
+    stages.swapItemsAt(currentStage, currentStage + 1);
+    currentStage += 1;
+    rebuildStageList();
+    applyFilter();
 }
 
 void MainWindow::setupUiExtras()
@@ -71,6 +232,21 @@ void MainWindow::setupUiExtras()
     viewOriginal  = new QGraphicsView(sceneOriginal,  this);
     viewProcessed = new QGraphicsView(sceneProcessed, this);
 
+    originalItem  = new TiledImageItem;
+    processedItem = new TiledImageItem;
+    sceneOriginal->addItem(originalItem);
+    sceneProcessed->addItem(processedItem);
+    regionItem = new TiledImageItem;
+    regionItem->setZValue(1);
+    regionItem->setVisible(false);
+    sceneProcessed->addItem(regionItem);
+    originalPlaceholder  = sceneOriginal->addText("Sem imagem");
+    processedPlaceholder = sceneProcessed->addText("Sem pré-visualização");
+    for (auto* t : { originalPlaceholder, processedPlaceholder }) {
+        QFont f = t->font(); f.setPointSize(f.pointSize()+6); t->setFont(f);
+        t->setDefaultTextColor(QColor(160,160,160));
+    }
+
     setNiceRenderHints(viewOriginal);
     setNiceRenderHints(viewProcessed);
 
@@ -84,18 +260,12 @@ void MainWindow::setupUiExtras()
     splitter->setStretchFactor(1, 1);
 
     cbFilter = new QComboBox(this);
-    cbFilter->addItems({
-        "Nenhum",
-        "Escala de Cinza",
-        "Equalização de Histograma",
-        "Desfoque Gaussiano",
-        "Canny",
-        "Brilho/Contraste",
-        "Espectro (FFT)"
-    });
+    cbFilter->addItems(SessionStore::filterNames());
     connect(cbFilter, &QComboBox::currentTextChanged, this, [this](const QString& name){
         cfg.name = name;
         updateControlsVisibility();
+        if (auto* item = stageList->item(currentStage))
+            item->setText(QString("%1. %2").arg(currentStage + 1).arg(name));
         applyFilter();
         if (doc.hasImage()) pushHistory(QString("Filtro: %1").arg(name));
     });
@@ -131,13 +301,87 @@ void MainWindow::setupUiExtras()
     connect(sBrightness, &QSlider::valueChanged, this, [this](int v){ cfg.brightness = v; lbBrightness->setText(QString("Brilho: %1").arg(v)); applyFilter(); if (doc.hasImage()) pushHistory(QString("Brilho/Contraste: brilho=%1 contraste=%2").arg(v).arg(cfg.contrast)); });
     connect(dsContrast,  qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double v){ cfg.contrast = v; applyFilter(); if (doc.hasImage()) pushHistory(QString("Brilho/Contraste: brilho=%1 contraste=%2").arg(cfg.brightness).arg(v)); });
 
+    dsGamma = new QDoubleSpinBox(this); dsGamma->setRange(0.1, 5.0); dsGamma->setSingleStep(0.1); dsGamma->setValue(cfg.gamma);
+    sbThreshold = new QSpinBox(this); sbThreshold->setRange(0, 255); sbThreshold->setValue(cfg.threshold);
+    connect(dsGamma, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double v){ cfg.gamma = v; applyFilter(); if (doc.hasImage()) pushHistory(QString("Gama: %1").arg(v)); });
+    connect(sbThreshold, qOverload<int>(&QSpinBox::valueChanged), this, [this](int v){ cfg.threshold = v; applyFilter(); if (doc.hasImage()) pushHistory(QString("Limiar: %1").arg(v)); });
+
+    cbFreqShape = new QComboBox(this); cbFreqShape->addItems({ "Ideal", "Butterworth", "Gaussiano" }); cbFreqShape->setCurrentText(cfg.freqShape);
+    dsCutoff = new QDoubleSpinBox(this); dsCutoff->setRange(1.0, 4000.0); dsCutoff->setSingleStep(5.0); dsCutoff->setValue(cfg.cutoff);
+    sbOrder = new QSpinBox(this); sbOrder->setRange(1, 10); sbOrder->setValue(cfg.order);
+    sbNotchU = new QSpinBox(this); sbNotchU->setRange(-4000, 4000); sbNotchU->setValue(cfg.notchU);
+    sbNotchV = new QSpinBox(this); sbNotchV->setRange(-4000, 4000); sbNotchV->setValue(cfg.notchV);
+    dsNotchRadius = new QDoubleSpinBox(this); dsNotchRadius->setRange(0.5, 500.0); dsNotchRadius->setSingleStep(0.5); dsNotchRadius->setValue(cfg.notchRadius);
+    auto frequencyHistory = [this]{
+        if (!doc.hasImage()) return;
+        if (cfg.name == "Notch (FFT)")
+            pushHistory(QString("Notch: %1 u=%2 v=%3 raio=%4").arg(cfg.freqShape).arg(cfg.notchU).arg(cfg.notchV).arg(cfg.notchRadius));
+        else
+            pushHistory(QString("%1: %2 corte=%3 ordem=%4").arg(cfg.name, cfg.freqShape).arg(cfg.cutoff).arg(cfg.order));
+    };
+    connect(cbFreqShape, &QComboBox::currentTextChanged, this, [this, frequencyHistory](const QString& v){ cfg.freqShape = v; updateControlsVisibility(); applyFilter(); frequencyHistory(); });
+    connect(dsCutoff, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, frequencyHistory](double v){ cfg.cutoff = v; applyFilter(); frequencyHistory(); });
+    connect(sbOrder, qOverload<int>(&QSpinBox::valueChanged), this, [this, frequencyHistory](int v){ cfg.order = v; applyFilter(); frequencyHistory(); });
+    connect(sbNotchU, qOverload<int>(&QSpinBox::valueChanged), this, [this, frequencyHistory](int v){ cfg.notchU = v; applyFilter(); frequencyHistory(); });
+    connect(sbNotchV, qOverload<int>(&QSpinBox::valueChanged), this, [this, frequencyHistory](int v){ cfg.notchV = v; applyFilter(); frequencyHistory(); });
+    connect(dsNotchRadius, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, frequencyHistory](double v){ cfg.notchRadius = v; applyFilter(); frequencyHistory(); });
+
+    stageList = new QListWidget(this);
+    stageList->setMaximumHeight(90);
+    connect(stageList, &QListWidget::currentRowChanged, this, &MainWindow::selectStage);
+    auto* btAddStage = new QPushButton("+", this);
+    auto* btRemoveStage = new QPushButton("-", this);
+    auto* btStageUp = new QPushButton("↑", this);
+    auto* btStageDown = new QPushButton("↓", this);
+    connect(btAddStage, &QPushButton::clicked, this, &MainWindow::addStage);
+    connect(btRemoveStage, &QPushButton::clicked, this, &MainWindow::removeStage);
+    connect(btStageUp, &QPushButton::clicked, this, &MainWindow::moveStageUp);
+    connect(btStageDown, &QPushButton::clicked, this, &MainWindow::moveStageDown);
+    auto* stageButtons = new QVBoxLayout;
+    stageButtons->setContentsMargins(0,0,0,0);
+    stageButtons->setSpacing(2);
+    stageButtons->addWidget(btAddStage);
+    stageButtons->addWidget(btRemoveStage);
+    stageButtons->addWidget(btStageUp);
+    stageButtons->addWidget(btStageDown);
+    auto* stageRow = new QHBoxLayout;
+    stageRow->setContentsMargins(0,0,0,0);
+    stageRow->addWidget(stageList, 1);
+    stageRow->addLayout(stageButtons);
+
+    cbPreview = new QCheckBox("Pré-visualização rápida (resolução da tela)", this);
+    cbPreview->setChecked(true);
+    connect(cbPreview, &QCheckBox::toggled, this, [this]{ applyFilter(); });
+    refineTimer = new QTimer(this);
+    refineTimer->setSingleShot(true);
+    refineTimer->setInterval(kRefineDelayMs);
+    connect(refineTimer, &QTimer::timeout, this, &MainWindow::refineFullResolution);
+    panTimer = new QTimer(this);
+    panTimer->setSingleShot(true);
+    panTimer->setInterval(kPanDelayMs);
+    connect(panTimer, &QTimer::timeout, this, &MainWindow::updateRegion);
+    for (auto* bar : { viewProcessed->horizontalScrollBar(), viewProcessed->verticalScrollBar() }) {
+        connect(bar, &QScrollBar::valueChanged, panTimer, qOverload<>(&QTimer::start));
+        connect(bar, &QScrollBar::rangeChanged, panTimer, qOverload<>(&QTimer::start));
+    }
+
     auto* form = new QFormLayout;
+    form->addRow("Etapas:", stageRow);
     form->addRow("Filtro:", cbFilter);
     form->addRow("Ksize (ímpar):", sbKsize);
     form->addRow("Sigma:", dsSigma);
     form->addRow("Canny Low:", sbLow);
     form->addRow("Canny High:", sbHigh);
     form->addRow(bcBox);
+    form->addRow("Gama:", dsGamma);
+    form->addRow("Limiar:", sbThreshold);
+    form->addRow("Forma:", cbFreqShape);
+    form->addRow("Corte (ciclos/imagem):", dsCutoff);
+    form->addRow("Ordem:", sbOrder);
+    form->addRow("Notch u:", sbNotchU);
+    form->addRow("Notch v:", sbNotchV);
+    form->addRow("Raio do notch:", dsNotchRadius);
+    form->addRow(cbPreview);
 
     detailsLabel = new QLabel(this);
     detailsLabel->setObjectName("detailsLabel");
@@ -154,8 +398,18 @@ void MainWindow::setupUiExtras()
     controlsVBox->addWidget(detailsLabel);
     controlsWidget->setLayout(controlsVBox);
 
+    docTabs = new QTabBar(this);
+    docTabs->setTabsClosable(true);
+    docTabs->setExpanding(false);
+    docTabs->setDocumentMode(true);
+    docTabs->hide();
+    connect(docTabs, &QTabBar::currentChanged, this, &MainWindow::switchDocument);
+    connect(docTabs, &QTabBar::tabCloseRequested, this, &MainWindow::closeDocument);
+    connect(documents, &DocumentStore::changed, this, &MainWindow::syncDocumentTabs);
+
     auto* central = new QWidget(this);
     auto* v = new QVBoxLayout;
+    v->addWidget(docTabs);
     v->addWidget(splitter);
     v->addWidget(controlsWidget);
     central->setLayout(v);
@@ -173,7 +427,29 @@ void MainWindow::setupUiExtras()
     historyDock->setWidget(historyList);
     addDockWidget(Qt::RightDockWidgetArea, historyDock);
 
+    latencyLabel = new QLabel(this);
+    latencyLabel->setToolTip("Tempo entre a edição e os pixels atualizados na tela");
+    statusBar()->addPermanentWidget(latencyLabel);
+    exportProgress = new QProgressBar(this);
+    exportProgress->setMaximumWidth(180);
+    exportProgress->setFormat("Exportando %v/%m");
+    exportProgress->hide();
+    statusBar()->addPermanentWidget(exportProgress);
+    connect(exportQueue, &ExportQueue::progress, this, [this](int done, int total){
+        exportProgress->setRange(0, total);
+        exportProgress->setValue(done);
+        exportProgress->show();
+    });
+    connect(exportQueue, &ExportQueue::written, this, [this](const QString& path, bool ok){
+        if (!ok) statusBar()->showMessage(QString("Falha ao gravar %1").arg(path));
+    });
+    connect(exportQueue, &ExportQueue::idle, this, [this](int count, int failed){
+        exportProgress->hide();
+        if (failed) QMessageBox::warning(this, "Erro", QString("Falha ao gravar %1 de %2 arquivos exportados.").arg(failed).arg(count));
+        else statusBar()->showMessage(QString("Exportação concluída (%1 arquivos).").arg(count));
+    });
     statusBar()->showMessage("Pronto");
+    rebuildStageList();
     updateControlsVisibility();
 }
 
@@ -183,41 +459,89 @@ void MainWindow::buildMenusAndToolbar()
     auto* menuArquivo = ui->menubar->addMenu("Arquivo");
     auto* actOpen   = new QAction(style()->standardIcon(QStyle::SP_DialogOpenButton), "Abrir imagem...", this);
     auto* actExport = new QAction(style()->standardIcon(QStyle::SP_DialogSaveButton), "Exportar processada...", this);
+    auto* actTiled  = new QAction("Processar arquivo grande em blocos...", this);
     auto* actSaveS  = new QAction("Salvar sessão", this);
     auto* actLoadS  = new QAction("Carregar sessão", this);
     auto* actExit   = new QAction("Sair", this);
 
     connect(actOpen,  &QAction::triggered, this, &MainWindow::openImage);
     connect(actExport,&QAction::triggered, this, &MainWindow::exportProcessed);
+    connect(actTiled, &QAction::triggered, this, &MainWindow::processLargeFile);
     connect(actSaveS, &QAction::triggered, this, &MainWindow::saveSession);
     connect(actLoadS, &QAction::triggered, this, &MainWindow::loadSession);
     connect(actExit,  &QAction::triggered, this, &MainWindow::exitApp);
 
     openRecentMenu = new QMenu("Abrir recentes", this);
+    openRecentMenu->setStyleSheet(QString("QMenu { icon-size: %1px; }").arg(ThumbnailCache::kSide / 2));
+    connect(thumbnails, &ThumbnailCache::thumbnailReady, this, [this](const QString& path, const QImage& thumb){
+        for (auto* a : openRecentMenu->actions())
+            if (a->data().toString() == path) a->setIcon(QIcon(QPixmap::fromImage(thumb)));
+    });
     menuArquivo->addAction(actOpen);
     menuArquivo->addMenu(openRecentMenu);
     menuArquivo->addSeparator();
     menuArquivo->addAction(actExport);
+    menuArquivo->addAction(actTiled);
     menuArquivo->addSeparator();
     menuArquivo->addAction(actSaveS);
     menuArquivo->addAction(actLoadS);
     menuArquivo->addSeparator();
     menuArquivo->addAction(actExit);
 
+    auto* menuEditar = ui->menubar->addMenu("Editar");
+    actUndo = new QAction("Desfazer", this);
+    actRedo = new QAction("Refazer", this);
+    auto* actUndoMem = new QAction("Memória do desfazer...", this);
+    auto* actSweep = new QAction("Varredura de parâmetros...", this);
+    actUndo->setShortcut(QKeySequence::Undo);
+    actRedo->setShortcuts(QList<QKeySequence>{ QKeySequence(Qt::CTRL | Qt::Key_Y), QKeySequence(QKeySequence::Redo) });
+    connect(actUndo, &QAction::triggered, this, &MainWindow::undoEdit);
+    connect(actRedo, &QAction::triggered, this, &MainWindow::redoEdit);
+    connect(actUndoMem, &QAction::triggered, this, &MainWindow::showUndoSettings);
+    connect(actSweep, &QAction::triggered, this, &MainWindow::showParameterSweep);
+    connect(undoStack, &UndoStack::changed, this, [this]{
+        actUndo->setEnabled(undoStack->canUndo());
+        actRedo->setEnabled(undoStack->canRedo());
+        actUndo->setText(undoStack->canUndo() ? QString("Desfazer (%1)").arg(undoStack->undoLabel()) : QString("Desfazer"));
+        actRedo->setText(undoStack->canRedo() ? QString("Refazer (%1)").arg(undoStack->redoLabel()) : QString("Refazer"));
+    });
+    actUndo->setEnabled(false);
+    actRedo->setEnabled(false);
+    menuEditar->addAction(actUndo);
+    menuEditar->addAction(actRedo);
+    menuEditar->addSeparator();
+    menuEditar->addAction(actSweep);
+    menuEditar->addSeparator();
+    menuEditar->addAction(actUndoMem);
+
     auto* menuExibir = ui->menubar->addMenu("Exibir");
     auto* actFit   = new QAction("Ajustar à Janela", this);
     auto* actZoomIn  = new QAction("Zoom +", this);
     auto* actZoomOut = new QAction("Zoom -", this);
     auto* actReset   = new QAction("Resetar Visão", this);
+    auto* actCache   = new QAction("Cache de resultados...", this);
+    auto* actDecoded = new QAction("Cache de imagens decodificadas...", this);
+    auto* actDocMem  = new QAction("Memória dos documentos...", this);
+    auto* actTrace   = new QAction("Exportar trace...", this);
     connect(actFit,    &QAction::triggered, this, &MainWindow::fitBothViews);
     connect(actZoomIn, &QAction::triggered, this, &MainWindow::zoomIn);
     connect(actZoomOut,&QAction::triggered, this, &MainWindow::zoomOut);
     connect(actReset,  &QAction::triggered, this, &MainWindow::resetView);
+    connect(actCache,  &QAction::triggered, this, &MainWindow::showCacheStats);
+    connect(actDecoded,&QAction::triggered, this, &MainWindow::showDecodedCacheSettings);
+    connect(actDocMem, &QAction::triggered, this, &MainWindow::showDocumentMemory);
+    connect(actTrace,  &QAction::triggered, this, &MainWindow::exportTrace);
     menuExibir->addAction(actFit);
     menuExibir->addAction(actZoomIn);
     menuExibir->addAction(actZoomOut);
     menuExibir->addSeparator();
     menuExibir->addAction(actReset);
+    menuExibir->addSeparator();
+    menuExibir->addAction(actCache);
+    menuExibir->addAction(actDecoded);
+    menuExibir->addAction(actDocMem);
+    menuExibir->addSeparator();
+    menuExibir->addAction(actTrace);
 
     auto* menuSobre = ui->menubar->addMenu("Sobre");
     auto* actSobre = new QAction("Sobre o ImageLabQt", this);
@@ -246,17 +570,21 @@ void MainWindow::rebuildOpenRecentMenu()
         return;
     }
     for (const auto& path : recentFiles) {
-        auto *a = new QAction(path, this);
+        auto *a = new QAction(path, openRecentMenu);
+        a->setData(path);
+        const QImage thumb = thumbnails->cached(path);
+        if (!thumb.isNull()) a->setIcon(QIcon(QPixmap::fromImage(thumb)));
         connect(a, &QAction::triggered, this, &MainWindow::openRecentTriggered);
         openRecentMenu->addAction(a);
     }
+    thumbnails->request(recentFiles);
 }
 
 void MainWindow::openImage()
 {
     auto path = QFileDialog::getOpenFileName(this, "Abrir imagem", QString(), "Imagens (*.png *.jpg *.jpeg *.bmp)");
     if (path.isEmpty()) return;
-    if (!doc.load(path)) {
+    if (!loadDocument(path)) {
         QMessageBox::warning(this, "Erro", "Falha ao abrir a imagem.");
         return;
     }
@@ -277,8 +605,8 @@ void MainWindow::openRecentTriggered()
 {
     auto* act = qobject_cast<QAction*>(sender());
     if (!act) return;
-    const QString path = act->text();
-    if (!doc.load(path)) {
+    const QString path = act->data().toString();
+    if (!loadDocument(path)) {
         QMessageBox::warning(this, "Erro", "Falha ao abrir a imagem recente.");
         return;
     }
@@ -294,22 +622,201 @@ void MainWindow::openRecentTriggered()
     statusBar()->showMessage(QString("Imagem carregada: %1").arg(path));
 }
 
+bool MainWindow::loadDocument(const QString& path)
+{
+    // Already open in another tab: switch to it.
+    const int open = documents->indexOf(path);
+    if (open >= 0 && open != documents->activeIndex()) return switchDocument(open);
+
+    ImageDocument next;
+    next.setDecodedCache(decodedCache);
+    const QFileInfo fi(path);
+    if (prefetched.path == fi.absoluteFilePath() && prefetched.mtime == fi.lastModified().toMSecsSinceEpoch()
+            && !prefetched.image.empty()) {
+        next.adopt(path, prefetched.image, prefetched.hash);
+        prefetched = Prefetched();
+    } else if (!next.load(path, true)) {
+        return false;
+    }
+    // Reopening the active document reloads it in its own tab, with a fresh
+    // undo history; otherwise the previous document keeps its own.
+    if (open >= 0) {
+        doc = std::move(next);
+        undoStack->clear();
+    } else {
+        documents->open(doc, *undoStack, std::move(next));
+    }
+    if (doc.isReduced()) decodeFullResolution();
+    // Opening changes which recent file is the likely next one.
+    QMetaObject::invokeMethod(this, &MainWindow::prefetchRecent, Qt::QueuedConnection);
+    return true;
+}
+
+bool MainWindow::switchDocument(int index)
+{
+    if (index < 0 || index == documents->activeIndex()) return true;
+    stages[currentStage] = cfg;
+    QString error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool ok = documents->activate(index, doc, *undoStack, &error);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        syncDocumentTabs();
+        QMessageBox::warning(this, "Erro", QString("Falha ao abrir o documento: %1.").arg(error));
+        return false;
+    }
+    if (doc.isReduced()) decodeFullResolution();
+    historyList->clear();
+    loadHistoryForCurrentImage();
+    applyFilter();
+    return true;
+}
+
+void MainWindow::closeDocument(int index)
+{
+    if (index == documents->activeIndex()) {
+        if (documents->count() > 1) {
+            if (!switchDocument(index + 1 < documents->count() ? index + 1 : index - 1)) return;
+        } else {
+            doc = ImageDocument();
+            doc.setDecodedCache(decodedCache);
+            undoStack->clear();
+            historyList->clear();
+            applyFilter();
+        }
+    }
+    documents->close(index);
+}
+
+void MainWindow::syncDocumentTabs()
+{
+    // Tabs mirror the store's order, so only their count and labels change.
+    const QSignalBlocker block(docTabs);
+    while (docTabs->count() > documents->count()) docTabs->removeTab(docTabs->count() - 1);
+    while (docTabs->count() < documents->count()) docTabs->addTab(QString());
+    for (int i = 0; i < documents->count(); ++i) {
+        docTabs->setTabText(i, documents->label(i));
+        docTabs->setTabToolTip(i, documents->pathAt(i));
+    }
+    docTabs->setCurrentIndex(documents->activeIndex());
+    docTabs->setVisible(documents->count() > 0);
+}
+
+void MainWindow::prefetchRecent()
+{
+    QString next;
+    for (const auto& path : recentFiles) {
+        if (documents->indexOf(path) >= 0) continue;
+        if (QFileInfo::exists(path)) next = path;
+        break;
+    }
+    const QFileInfo fi(next);
+    if (next.isEmpty() || (prefetched.path == fi.absoluteFilePath()
+                           && prefetched.mtime == fi.lastModified().toMSecsSinceEpoch())) return;
+
+    prefetched = Prefetched();
+    prefetched.path = fi.absoluteFilePath();
+    prefetched.mtime = fi.lastModified().toMSecsSinceEpoch();
+    const auto cache = decodedCache;
+    QPointer<MainWindow> self(this);
+    QThreadPool::globalInstance()->start([self, cache, next, absolute = prefetched.path, mtime = prefetched.mtime]{
+        cv::Mat img;
+        quint64 hash = 0;
+        if (!cache->lookup(next, img, &hash)) {
+            img = cv::imread(next.toStdString(), cv::IMREAD_COLOR);
+            hash = ImageDocument::hashPixels(img);
+        }
+        QMetaObject::invokeMethod(qApp, [self, absolute, mtime, img, hash]{
+            // Superseded by a newer prefetch, or already opened.
+            if (!self || self->prefetched.path != absolute || self->prefetched.mtime != mtime) return;
+            self->prefetched.image = img;
+            self->prefetched.hash = hash;
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::decodeFullResolution()
+{
+    const QString path = doc.lastPath();
+    const quint64 gen = doc.generation();
+    statusBar()->showMessage(QString("Carregando resolução total (%1×%2)...")
+                                 .arg(doc.fullSize().width).arg(doc.fullSize().height));
+    QPointer<MainWindow> self(this);
+    QThreadPool::globalInstance()->start([self, path, gen]{
+        const cv::Mat full = cv::imread(path.toStdString(), cv::IMREAD_COLOR);
+        const quint64 hash = ImageDocument::hashPixels(full);
+        QMetaObject::invokeMethod(qApp, [self, gen, full, hash]{
+            // Another image was opened (or this one finished loading) meanwhile.
+            if (!self || self->doc.generation() != gen) return;
+            if (full.empty()) {
+                self->statusBar()->showMessage("Falha ao carregar a resolução total; exibindo versão reduzida.");
+                return;
+            }
+            self->doc.setFullResolution(full, hash);
+            self->applyFilter();
+            self->refreshViews();
+            self->statusBar()->showMessage("Resolução total carregada.");
+        }, Qt::QueuedConnection);
+    });
+}
+
 void MainWindow::exportProcessed()
 {
     if (!doc.hasImage()) { QMessageBox::information(this, "Info", "Abra uma imagem primeiro."); return; }
-    auto out = QFileDialog::getSaveFileName(this, "Exportar processada", "processed.png", "Imagens (*.png *.jpg *.jpeg *.bmp)");
+    auto out = QFileDialog::getSaveFileName(this, "Exportar processada", "processed.png",
+                                            "Imagens (*.png *.jpg *.jpeg *.webp *.tif *.tiff *.bmp)");
     if (out.isEmpty()) return;
-    if (!doc.saveProcessed(out)) QMessageBox::warning(this, "Erro", "Falha ao salvar a imagem processada.");
-    else {
-        pushHistory(QString("Exportou: %1").arg(out));
-        statusBar()->showMessage("Imagem exportada com sucesso.");
+    ExportDialog dlg(out, exportOptionsFromJson(session.loadSetting("exportOptions").toObject()), this);
+    if (dlg.exec() != QDialog::Accepted) return;
+    const ExportQueue::EncoderOptions opts = dlg.options();
+    const QList<ExportQueue::Target> targets = dlg.targets();
+    session.saveSetting("exportOptions", exportOptionsToJson(opts));
+
+    // Only a full-resolution result of the newest request can be written as
+    // is; otherwise the export renders the stages itself, off the UI thread.
+    // A document still showing its reduced decode is decoded in full there
+    // too, from its file.
+    const bool current = shownRequest == filterWorker->latestRequest() && !doc.processedIsPreview()
+                      && !doc.processedMat().empty();
+    if (doc.isReduced()) exportQueue->submit(doc.lastPath(), stages, targets, opts);
+    else if (current) exportQueue->submit(doc.processedMat(), targets, opts);
+    else exportQueue->submit(doc.originalMat(), stages, targets, opts);
+    pushHistory(targets.size() > 1 ? QString("Exportou: %1 (+%2 arquivos)").arg(out).arg(targets.size() - 1)
+                                   : QString("Exportou: %1").arg(out));
+}
+
+void MainWindow::processLargeFile()
+{
+    QString why;
+    if (!TiledProcessor::supports(stages, &why)) {
+        QMessageBox::information(this, "Info", QString("Não é possível processar em blocos: %1.").arg(why));
+        return;
     }
+    const auto in = QFileDialog::getOpenFileName(this, "Arquivo grande", QString(), "Imagens (*.ppm *.pgm *.png *.jpg *.jpeg *.bmp *.tif *.tiff)");
+    if (in.isEmpty()) return;
+    const auto out = QFileDialog::getSaveFileName(this, "Salvar resultado", "processed.ppm", "Imagens (*.ppm *.pgm *.png *.jpg *.jpeg *.bmp *.tif *.tiff)");
+    if (out.isEmpty()) return;
+
+    statusBar()->showMessage(QString("Processando em blocos: %1").arg(in));
+    const QList<FilterConfig> chain = stages;
+    QPointer<MainWindow> self(this);
+    QThreadPool::globalInstance()->start([self, in, out, chain]{
+        QString error;
+        const bool ok = TiledProcessor(kTiledMemoryLimit).process(in, out, chain, &error);
+        // Posted through qApp: the window may be gone by the time this ends.
+        QMetaObject::invokeMethod(qApp, [self, ok, out, error]{
+            if (!self) return;
+            if (ok) self->statusBar()->showMessage(QString("Resultado gravado em %1").arg(out));
+            else QMessageBox::warning(self, "Erro", QString("Falha no processamento em blocos: %1").arg(error));
+        }, Qt::QueuedConnection);
+    });
 }
 
 void MainWindow::saveSession()
 {
     const QString last = doc.lastPath();
-    if (!session.save(last, cfg)) {
+    stages[currentStage] = cfg;
+    if (!session.save(last, stages)) {
         QMessageBox::warning(this, "Erro", "Não foi possível salvar a sessão.");
     } else {
         statusBar()->showMessage("Sessão salva em session.json");
@@ -319,20 +826,16 @@ void MainWindow::saveSession()
 void MainWindow::loadSession()
 {
     QString last;
-    FilterConfig loaded;
+    QList<FilterConfig> loaded;
     if (!session.load(last, loaded)) {
         QMessageBox::information(this, "Info", "Nenhuma sessão encontrada.");
         return;
     }
-    loaded.name = mapLegacyFilterName(loaded.name);
-    cfg = loaded;
-    cbFilter->setCurrentText(cfg.name);
-    if (!last.isEmpty()) {
-        if (doc.load(last)) {
-            applyFilter();
-            loadHistoryForCurrentImage();
-        }
+    setStages(loaded);
+    if (!last.isEmpty() && loadDocument(last)) {
+        loadHistoryForCurrentImage();
     }
+    applyFilter();
     recentFiles = session.loadRecent();
     rebuildOpenRecentMenu();
     statusBar()->showMessage("Sessão carregada.");
@@ -342,31 +845,336 @@ void MainWindow::exitApp() { close(); }
 
 void MainWindow::applyFilter()
 {
-    const bool has = doc.hasImage();
-
-    const cv::Mat& src = has ? doc.originalMat() : cv::Mat();
-    cv::Mat out = src.empty() ? cv::Mat() : src.clone();
-
-    if (has) {
-        if (cfg.name == "Nenhum") {
-        } else if (cfg.name == "Escala de Cinza") {
-            out = Filters::toGrayscale(src);
-        } else if (cfg.name == "Equalização de Histograma") {
-            out = Filters::equalizeHistColor(src);
-        } else if (cfg.name == "Desfoque Gaussiano") {
-            out = Filters::gaussianBlur(src, cfg.ksize, cfg.sigma);
-        } else if (cfg.name == "Canny") {
-            out = Filters::canny(src, cfg.lowThresh, cfg.highThresh);
-        } else if (cfg.name == "Brilho/Contraste") {
-            out = Filters::brightnessContrast(src, cfg.brightness, cfg.contrast);
-        } else if (cfg.name == "Espectro (FFT)") {
-            out = Filters::fftMagnitudeSpectrum(src);
+    IMAGELAB_TRACE_SCOPE("MainWindow::applyFilter");
+    stages[currentStage] = cfg;
+    if (doc.hasImage() && editStartNs < 0) {
+        editStartNs = Profiler::instance().now();
+        editStartCounters = MatPool::counters();
+    }
+    if (doc.hasImage()) {
+        refineTimer->stop();
+        bool hit = showCachedResult(1.0);
+        if (!hit) {
+            cv::Rect visible, region;
+            if (visibleRegion(visible, region)) {
+                submitRegion(region);
+            } else {
+                const double scale = previewScale();
+                hit = scale < 1.0 && showCachedResult(scale);
+                if (!hit) submitRender(scale);
+                if (scale < 1.0) refineTimer->start();
+            }
         }
-        doc.setProcessed(out);
+        // One hit or miss per edit; the later refinement is not counted.
+        resultCache.recordLookup(hit);
+    } else {
+        refineTimer->stop();
+        filterWorker->cancelAll();
     }
 
     detailsLabel->setText(filterSummaryText());
+    // A freshly loaded image has no processed result yet; show the original
+    // right away instead of waiting for the worker.
+    if (doc.processedMat().empty()) refreshViews();
+}
+
+void MainWindow::onFilterFinished(quint64 requestId, const cv::Mat& result, double scale, const cv::Rect& region)
+{
+    if (requestId != filterWorker->latestRequest()) return;
+    if (!region.empty()) {
+        regionItem->setImage(result);
+        const double f = 1.0 / doc.originalScale();
+        regionItem->setTransform(QTransform::fromScale(f, f));
+        regionItem->setPos(region.x * f, region.y * f);
+        regionItem->setVisible(true);
+        shownRegion = region;
+        shownRegionKey = pendingRegionKey;
+        // The state is recorded without pixels; they are rendered again if
+        // it is ever restored.
+        recordUndoState(cv::Mat());
+        markEditDisplayed();
+        return;
+    }
+    if (requestId == pendingRequest) resultCache.insert(pendingKey, result);
+    clearRegion();
+    doc.setProcessed(result, scale);
+    shownRequest = requestId;
+    if (scale >= 1.0) recordUndoState(result);
     refreshViews();
+    markEditDisplayed();
+}
+
+void MainWindow::refineFullResolution()
+{
+    if (!doc.hasImage()) return;
+    if (!showCachedResult(1.0)) submitRender(1.0);
+}
+
+bool MainWindow::showCachedResult(double scale)
+{
+    cv::Mat cached;
+    if (!resultCache.lookup(ResultCache::keyFor(doc.contentHash(), stages, scale), cached)) return false;
+    // Anything still running is now stale.
+    filterWorker->cancelAll();
+    shownRequest = filterWorker->latestRequest();
+    clearRegion();
+    doc.setProcessed(cached, scale);
+    if (scale >= 1.0) recordUndoState(cached);
+    refreshViews();
+    markEditDisplayed();
+    return true;
+}
+
+void MainWindow::submitRender(double scale)
+{
+    pendingKey = ResultCache::keyFor(doc.contentHash(), stages, scale);
+    pendingRequest = filterWorker->submit(doc.originalMat(), stages, scale, cv::Rect(), doc.originalScale());
+}
+
+bool MainWindow::visibleRegion(cv::Rect& visible, cv::Rect& padded) const
+{
+    if (!cbPreview->isChecked() || !doc.hasImage() || !FilterPipeline::supportsRegion(stages)) return false;
+    const cv::Mat& src = doc.originalMat();
+    if (double(src.total()) < kPreviewMinPixels) return false;
+
+    // Scene units are full-resolution pixels; the original may be reduced.
+    const double s = doc.originalScale();
+    const QRectF r = viewProcessed->mapToScene(viewProcessed->viewport()->rect()).boundingRect();
+    const cv::Rect bounds(0, 0, src.cols, src.rows);
+    const int x0 = int(std::floor(r.left() * s)), y0 = int(std::floor(r.top() * s));
+    const int x1 = int(std::ceil(r.right() * s)), y1 = int(std::ceil(r.bottom() * s));
+    visible = cv::Rect(x0, y0, x1 - x0, y1 - y0) & bounds;
+    if (visible.empty() || visible.area() > kRegionMaxFraction * bounds.area()) return false;
+
+    const int mx = int(visible.width * kRegionMargin), my = int(visible.height * kRegionMargin);
+    padded = cv::Rect(visible.x - mx, visible.y - my, visible.width + 2 * mx, visible.height + 2 * my) & bounds;
+    return true;
+}
+
+void MainWindow::submitRegion(const cv::Rect& region)
+{
+    pendingRegion = region;
+    pendingRegionKey = ResultCache::keyFor(doc.contentHash(), stages, 1.0);
+    pendingRegionRequest = filterWorker->submit(doc.originalMat(), stages, 1.0, region, doc.originalScale());
+}
+
+void MainWindow::clearRegion()
+{
+    if (shownRegion.empty()) return;
+    regionItem->clear();
+    regionItem->setVisible(false);
+    shownRegion = cv::Rect();
+    shownRegionKey.clear();
+}
+
+void MainWindow::updateRegion()
+{
+    cv::Rect visible, region;
+    if (!visibleRegion(visible, region)) {
+        // Zoomed back out: what lies outside the rendered regions is stale.
+        if (!shownRegion.empty() || (pendingRegionRequest && pendingRegionRequest == filterWorker->latestRequest()))
+            applyFilter();
+        return;
+    }
+    // Nothing to do while the full current result is on screen.
+    if (shownRequest == filterWorker->latestRequest() && !doc.processedIsPreview() && !doc.processedMat().empty())
+        return;
+    const QByteArray key = ResultCache::keyFor(doc.contentHash(), stages, 1.0);
+    if (shownRegionKey == key && (shownRegion & visible) == visible) return;
+    if (pendingRegionRequest == filterWorker->latestRequest() && pendingRegionKey == key
+            && (pendingRegion & visible) == visible)
+        return;
+    submitRegion(region);
+}
+
+void MainWindow::showCacheStats()
+{
+    const auto st = resultCache.stats();
+    const quint64 lookups = st.hits + st.misses;
+    const QString text = QString("Entradas: %1\nOcupação: %2 MB de %3 MB\n"
+                                 "Acertos: %4   Falhas: %5   (taxa de acerto %6%)\n\n"
+                                 "Orçamento (MB):")
+        .arg(st.entries)
+        .arg(st.residentBytes / double(1 << 20), 0, 'f', 1)
+        .arg(st.budgetBytes >> 20)
+        .arg(st.hits).arg(st.misses)
+        .arg(lookups ? 100.0 * st.hits / lookups : 0.0, 0, 'f', 1);
+    bool ok = false;
+    const int mb = QInputDialog::getInt(this, "Cache de resultados", text,
+                                        int(st.budgetBytes >> 20), 16, 65536, 16, &ok);
+    if (!ok) return;
+    resultCache.setBudget(qint64(mb) << 20);
+    session.saveSetting("resultCacheMB", mb);
+}
+
+void MainWindow::markEditDisplayed()
+{
+    // Measures from the first edit not yet on screen to the first pixels
+    // that reflect it (a preview counts).
+    if (editStartNs < 0) return;
+    Profiler& prof = Profiler::instance();
+    const qint64 dur = prof.now() - editStartNs;
+    prof.record("edição → pixels", editStartNs, dur);
+    editStartNs = -1;
+
+    recentLatenciesMs.push_back(dur / 1e6);
+    if (recentLatenciesMs.size() > kLatencyWindow) recentLatenciesMs.removeFirst();
+    double sum = 0, worst = 0;
+    for (double v : recentLatenciesMs) { sum += v; worst = qMax(worst, v); }
+    // Counted process-wide, so work still running for older edits is included.
+    const MatPool::Counters c = MatPool::counters();
+    latencyLabel->setText(QString("Latência: %1 ms  (média %2 ms, máx %3 ms, últimas %4)  •  "
+                                  "alocações: %5, reutilizações: %6")
+                              .arg(recentLatenciesMs.last(), 0, 'f', 0)
+                              .arg(sum / recentLatenciesMs.size(), 0, 'f', 0)
+                              .arg(worst, 0, 'f', 0)
+                              .arg(recentLatenciesMs.size())
+                              .arg(c.allocations - editStartCounters.allocations)
+                              .arg(c.reuses - editStartCounters.reuses));
+}
+
+void MainWindow::exportTrace()
+{
+    const auto out = QFileDialog::getSaveFileName(this, "Exportar trace", "imagelab-trace.json", "Chrome trace (*.json)");
+    if (out.isEmpty()) return;
+    if (!Profiler::instance().writeChromeTrace(out))
+        QMessageBox::warning(this, "Erro", "Falha ao gravar o trace.");
+    else
+        statusBar()->showMessage(QString("Trace gravado em %1 (abra em chrome://tracing ou ui.perfetto.dev)").arg(out));
+}
+
+void MainWindow::recordUndoState(const cv::Mat& result)
+{
+    // Results of a reduced decode are previews of the real image.
+    if (doc.isReduced()) return;
+    UndoStack::State st;
+    st.stages = stages;
+    st.currentStage = currentStage;
+    QStringList names;
+    for (const auto& s : stages) names << s.name;
+    st.label = names.join(" → ");
+    undoStack->record(ResultCache::keyFor(doc.contentHash(), stages, 1.0), st, result);
+}
+
+void MainWindow::restoreUndoState(const UndoStack::State& state, const cv::Mat& result)
+{
+    stages = state.stages;
+    currentStage = qBound(0, state.currentStage, stages.size() - 1);
+    cfg = stages[currentStage];
+    syncControlsFromConfig();
+    rebuildStageList();
+    if (!result.empty()) {
+        refineTimer->stop();
+        filterWorker->cancelAll();
+        shownRequest = filterWorker->latestRequest();
+        clearRegion();
+        doc.setProcessed(result, 1.0);
+        refreshViews();
+        detailsLabel->setText(filterSummaryText());
+    } else {
+        // Pixels were dropped to stay within budget; render from the stages.
+        applyFilter();
+    }
+}
+
+void MainWindow::undoEdit()
+{
+    UndoStack::State st;
+    cv::Mat result;
+    if (!undoStack->undo(st, result)) return;
+    restoreUndoState(st, result);
+    pushHistory(QString("Desfazer: %1").arg(st.label));
+}
+
+void MainWindow::redoEdit()
+{
+    UndoStack::State st;
+    cv::Mat result;
+    if (!undoStack->redo(st, result)) return;
+    restoreUndoState(st, result);
+    pushHistory(QString("Refazer: %1").arg(st.label));
+}
+
+void MainWindow::showUndoSettings()
+{
+    const auto st = undoStack->stats();
+    const QString text = QString("Estados: %1 (%2 em memória, %3 comprimidos, %4 recalculáveis)\n"
+                                 "Ocupação: %5 MB de %6 MB\n\nOrçamento (MB):")
+        .arg(st.entries).arg(st.resident).arg(st.compressed).arg(st.dropped)
+        .arg(st.bytes / double(1 << 20), 0, 'f', 1)
+        .arg(st.budgetBytes >> 20);
+    bool ok = false;
+    const int mb = QInputDialog::getInt(this, "Memória do desfazer", text,
+                                        int(st.budgetBytes >> 20), 0, 65536, 64, &ok);
+    if (!ok) return;
+    undoStack->setBudget(qint64(mb) << 20);
+    session.saveSetting("undoMB", mb);
+}
+
+void MainWindow::showParameterSweep()
+{
+    if (!doc.hasImage()) { QMessageBox::information(this, "Info", "Abra uma imagem primeiro."); return; }
+    stages[currentStage] = cfg;
+    if (ParameterSweep::parametersOf(cfg).isEmpty()) {
+        QMessageBox::information(this, "Info", QString("O filtro \"%1\" não tem parâmetros para varrer.").arg(cfg.name));
+        return;
+    }
+    const cv::Mat& src = doc.originalMat();
+    const double scale = qMin(1.0, double(kSweepPreviewSide) / qMax(src.cols, src.rows));
+    SweepDialog dlg(src, stages, currentStage, scale, doc.originalScale(), this);
+    if (dlg.exec() != QDialog::Accepted) return;
+    cfg = dlg.chosen();
+    syncControlsFromConfig();
+    applyFilter();
+    pushHistory(QString("Varredura: %1").arg(cfg.name));
+}
+
+void MainWindow::showDocumentMemory()
+{
+    QStringList lines;
+    for (int i = 0; i < documents->count(); ++i)
+        lines << QString("%1%2").arg(i == documents->activeIndex() ? "▸ " : "   ", documents->label(i));
+    const QString text = QString("Documentos inativos são comprimidos em PNG ou liberados (e relidos do disco)\n"
+                                 "quando o total passa do orçamento.\n\n%1\n\nOcupação: %2 MB de %3 MB\n\n"
+                                 "Orçamento (MB):")
+        .arg(lines.isEmpty() ? QString("(nenhum documento aberto)") : lines.join("\n"))
+        .arg(documents->usage() / double(1 << 20), 0, 'f', 1)
+        .arg(documents->budget() >> 20);
+    bool ok = false;
+    const int mb = QInputDialog::getInt(this, "Memória dos documentos", text,
+                                        int(documents->budget() >> 20), 64, 65536, 64, &ok);
+    if (!ok) return;
+    documents->setBudget(qint64(mb) << 20);
+    session.saveSetting("documentsMB", mb);
+}
+
+void MainWindow::showDecodedCacheSettings()
+{
+    const QString text = QString("Imagens recentes já decodificadas são reabertas do disco sem nova decodificação.\n"
+                                 "Pasta: %1\nOcupação: %2 MB\n\nCota em disco (MB, 0 desativa):")
+        .arg(decodedCache->directory())
+        .arg(decodedCache->diskUsage() / double(1 << 20), 0, 'f', 1);
+    bool ok = false;
+    const int mb = QInputDialog::getInt(this, "Cache de imagens decodificadas", text,
+                                        int(decodedCache->quota() >> 20), 0, 1 << 20, 256, &ok);
+    if (!ok) return;
+    decodedCache->setQuota(qint64(mb) << 20);
+    session.saveSetting("decodedCacheMB", mb);
+}
+
+double MainWindow::previewScale() const
+{
+    if (!cbPreview->isChecked() || !doc.hasImage()) return 1.0;
+    if (double(doc.originalMat().total()) < kPreviewMinPixels) return 1.0;
+
+    // Device pixels per image pixel in the processed view; render at the
+    // largest power-of-two reduction that still covers it.
+    // Scene units are full-resolution pixels; a reduced decode has fewer.
+    const double onScreen = viewProcessed->transform().m11() * viewProcessed->devicePixelRatioF()
+                          / doc.originalScale();
+    double scale = 1.0;
+    while (scale > 1.0 / 16 && scale * 0.5 >= onScreen) scale *= 0.5;
+    return scale;
 }
 
 QString MainWindow::filterSummaryText() const
@@ -383,38 +1191,78 @@ QString MainWindow::filterSummaryText() const
         s += QString("  •  low=<b>%1</b>   high=<b>%2</b>").arg(cfg.lowThresh).arg(cfg.highThresh);
     } else if (cfg.name == "Brilho/Contraste") {
         s += QString("  •  brilho=<b>%1</b>   contraste=<b>%2</b>").arg(cfg.brightness).arg(cfg.contrast, 0, 'f', 2);
+    } else if (cfg.name == "Gama") {
+        s += QString("  •  gama=<b>%1</b>").arg(cfg.gamma, 0, 'f', 2);
+    } else if (cfg.name == "Inverter") {
+        s += "  •  negativo da imagem.";
+    } else if (cfg.name == "Limiar") {
+        s += QString("  •  limiar=<b>%1</b>").arg(cfg.threshold);
     } else if (cfg.name == "Espectro (FFT)") {
         s += "  •  exibe o espectro de magnitude (DFT centralizada).";
+    } else if (cfg.name == "Passa-Baixa (FFT)" || cfg.name == "Passa-Alta (FFT)") {
+        s += QString("  •  %1   corte=<b>%2</b> ciclos/imagem").arg(cfg.freqShape).arg(cfg.cutoff, 0, 'f', 1);
+        if (cfg.freqShape == "Butterworth") s += QString("   ordem=<b>%1</b>").arg(cfg.order);
+    } else if (cfg.name == "Notch (FFT)") {
+        s += QString("  •  %1   rejeita (±%2, ±%3), raio=<b>%4</b>")
+                 .arg(cfg.freqShape).arg(cfg.notchU).arg(cfg.notchV).arg(cfg.notchRadius, 0, 'f', 1);
     } else if (cfg.name == "Equalização de Histograma") {
         s += "  •  equalização no canal Y (YCrCb).";
     } else if (cfg.name == "Escala de Cinza") {
         s += "  •  conversão para tons de cinza.";
     }
+    if (stages.size() > 1) {
+        QStringList names;
+        for (const auto& st : stages) names << st.name;
+        s += QString("<br>Pipeline (etapa %1 de %2): %3")
+                 .arg(currentStage + 1).arg(stages.size()).arg(names.join(" → "));
+    }
     return s;
 }
 
 void MainWindow::refreshViews()
 {
-    sceneOriginal->clear();
-    sceneProcessed->clear();
-
+    IMAGELAB_TRACE_SCOPE("MainWindow::refreshViews");
+    // The original only changes on load; its pyramid is rebuilt once per
+    // document and the processed item only when the result buffer changes.
     if (doc.hasImage()) {
-        auto qOrig = Filters::matToQImage(doc.originalMat());
-        sceneOriginal->addPixmap(QPixmap::fromImage(qOrig));
-    } else {
-        auto *t = sceneOriginal->addText("Sem imagem");
-        QFont f = t->font(); f.setPointSize(f.pointSize()+6); t->setFont(f);
-        t->setDefaultTextColor(QColor(160,160,160));
+        if (shownGeneration != doc.generation()) {
+            originalItem->setImage(doc.originalMat());
+            // Scene coordinates are full-resolution pixels, also while only
+            // the reduced decode is available.
+            originalItem->setTransform(QTransform::fromScale(1.0 / doc.originalScale(), 1.0 / doc.originalScale()));
+            shownGeneration = doc.generation();
+            clearRegion();
+        }
+    } else if (shownGeneration != 0) {
+        originalItem->clear();
+        shownGeneration = 0;
+        clearRegion();
     }
-
-    if (!doc.processedMat().empty()) {
-        auto qProc = Filters::matToQImage(doc.processedMat());
-        sceneProcessed->addPixmap(QPixmap::fromImage(qProc));
-    } else {
-        auto *t = sceneProcessed->addText("Sem pré-visualização");
-        QFont f = t->font(); f.setPointSize(f.pointSize()+6); t->setFont(f);
-        t->setDefaultTextColor(QColor(160,160,160));
+    originalItem->setVisible(doc.hasImage());
+    originalPlaceholder->setVisible(!doc.hasImage());
+    sceneOriginal->setSceneRect(doc.hasImage() ? originalItem->sceneBoundingRect()
+                                               : originalPlaceholder->sceneBoundingRect());
+
+    const cv::Mat& proc = doc.processedMat();
+    if (!proc.empty()) {
+        if (processedItem->image().data != proc.data || processedItem->image().size != proc.size)
+            processedItem->setImage(proc);
+        // Previews are smaller than the original; keep scene coordinates in
+        // full-resolution pixels so zoom and fit behave the same for both views.
+        QTransform t;
+        if (doc.processedIsPreview() && doc.hasImage()) {
+            const cv::Size full = doc.fullSize();
+            t = QTransform::fromScale(double(full.width) / proc.cols, double(full.height) / proc.rows);
+        }
+        processedItem->setTransform(t);
+    } else if (!processedItem->image().empty()) {
+        processedItem->clear();
     }
+    processedItem->setVisible(!proc.empty());
+    processedPlaceholder->setVisible(proc.empty());
+    sceneProcessed->setSceneRect(!proc.empty() ? processedItem->sceneBoundingRect()
+                                               : processedPlaceholder->sceneBoundingRect());
+    documents->updateActive(doc);
 }
 
 void MainWindow::updateControlsVisibility()
@@ -423,6 +1271,11 @@ void MainWindow::updateControlsVisibility()
     const bool g  = (n == "Desfoque Gaussiano");
     const bool c  = (n == "Canny");
     const bool bc = (n == "Brilho/Contraste");
+    const bool gm = (n == "Gama");
+    const bool th = (n == "Limiar");
+    const bool pass = (n == "Passa-Baixa (FFT)" || n == "Passa-Alta (FFT)");
+    const bool notch = (n == "Notch (FFT)");
+    const bool butterworth = (cbFreqShape && cbFreqShape->currentText() == "Butterworth");
 
     if (sbKsize) sbKsize->setVisible(g);
     if (dsSigma) dsSigma->setVisible(g);
@@ -431,6 +1284,14 @@ void MainWindow::updateControlsVisibility()
     if (lbBrightness) lbBrightness->setVisible(bc);
     if (sBrightness) sBrightness->setVisible(bc);
     if (dsContrast) dsContrast->setVisible(bc);
+    if (dsGamma) dsGamma->setVisible(gm);
+    if (sbThreshold) sbThreshold->setVisible(th);
+    if (cbFreqShape) cbFreqShape->setVisible(pass || notch);
+    if (dsCutoff) dsCutoff->setVisible(pass);
+    if (sbOrder) sbOrder->setVisible((pass || notch) && butterworth);
+    if (sbNotchU) sbNotchU->setVisible(notch);
+    if (sbNotchV) sbNotchV->setVisible(notch);
+    if (dsNotchRadius) dsNotchRadius->setVisible(notch);
 }
 
 
@@ -453,10 +1314,10 @@ void MainWindow::loadHistoryForCurrentImage()
 
 void MainWindow::fitBothViews()
 {
-    if (sceneOriginal && !sceneOriginal->items().isEmpty())
-        viewOriginal->fitInView(sceneOriginal->itemsBoundingRect(), Qt::KeepAspectRatio);
-    if (sceneProcessed && !sceneProcessed->items().isEmpty())
-        viewProcessed->fitInView(sceneProcessed->itemsBoundingRect(), Qt::KeepAspectRatio);
+    if (sceneOriginal)
+        viewOriginal->fitInView(sceneOriginal->sceneRect(), Qt::KeepAspectRatio);
+    if (sceneProcessed)
+        viewProcessed->fitInView(sceneProcessed->sceneRect(), Qt::KeepAspectRatio);
     currentScale = 1.0;
 }
 
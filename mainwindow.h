@@ -4,6 +4,7 @@
 #include <QMainWindow>
 #include <QGraphicsView>
 #include <QGraphicsScene>
+#include <QGraphicsTextItem>
 #include <QComboBox>
 #include <QSlider>
 #include <QLabel>
@@ -13,9 +14,23 @@
 #include <QToolBar>
 #include <QDockWidget>
 #include <QMap>
+#include <QThread>
+#include <QCheckBox>
+#include <QTimer>
+#include <QProgressBar>
+#include <QTabBar>
 
 #include "ImageDocument.h"
+#include "DocumentStore.h"
 #include "SessionStore.h"
+#include "FilterWorker.h"
+#include "ResultCache.h"
+#include "DecodedCache.h"
+#include "ThumbnailCache.h"
+#include "UndoStack.h"
+#include "ExportQueue.h"
+#include "MatPool.h"
+#include "TiledImageItem.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -33,6 +48,7 @@ private slots:
     void openImage();
     void openRecentTriggered();
     void exportProcessed();
+    void processLargeFile();
     void saveSession();
     void loadSession();
     void exitApp();
@@ -43,28 +59,89 @@ private slots:
     void zoomOut();
     void resetView();
     void showAbout();
+    void onFilterFinished(quint64 requestId, const cv::Mat& result, double scale, const cv::Rect& region);
+    void updateRegion();
+    void refineFullResolution();
+    void showCacheStats();
+    void showDecodedCacheSettings();
+    void undoEdit();
+    void redoEdit();
+    void showUndoSettings();
+    void showParameterSweep();
+    void showDocumentMemory();
+    bool switchDocument(int index);
+    void closeDocument(int index);
+    void exportTrace();
+    void selectStage(int row);
+    void addStage();
+    void removeStage();
+    void moveStageUp();
+    void moveStageDown();
 
 private:
+    void setupFilterWorker();
     void setupUiExtras();
     void buildMenusAndToolbar();
     void rebuildOpenRecentMenu();
+    void rebuildStageList();
+    void syncControlsFromConfig();
+    void setStages(const QList<FilterConfig>& loaded);
+    bool loadDocument(const QString& path);
+    void syncDocumentTabs();
+    void prefetchRecent();
+    void recordUndoState(const cv::Mat& result);
+    void markEditDisplayed();
+    void restoreUndoState(const UndoStack::State& state, const cv::Mat& result);
+    void decodeFullResolution();
     void refreshViews();
     void pushHistory(const QString& opText);
     void loadHistoryForCurrentImage();
     void setScale(QGraphicsView* view, double factor);
+    double previewScale() const;
+    bool showCachedResult(double scale);
+    void submitRender(double scale);
+    bool visibleRegion(cv::Rect& visible, cv::Rect& padded) const;
+    void submitRegion(const cv::Rect& region);
+    void clearRegion();
     void setNiceRenderHints(QGraphicsView* v);
     QString filterSummaryText() const;
-    QString mapLegacyFilterName(const QString& legacy) const;
 
     Ui::MainWindow *ui;
 
+    // The active document; the other open ones are parked in `documents`.
     ImageDocument doc;
+    DocumentStore* documents = nullptr;
+    QTabBar* docTabs = nullptr;
     SessionStore session { "session.json" };
 
+    QThread* filterThread = nullptr;
+    FilterWorker* filterWorker = nullptr;
+    quint64 shownRequest = 0;
+    quint64 pendingRequest = 0;
+    QByteArray pendingKey;
+    ResultCache resultCache;
+    std::shared_ptr<DecodedCache> decodedCache;
+    UndoStack* undoStack = nullptr;
+    QAction* actUndo = nullptr;
+    QAction* actRedo = nullptr;
+    ExportQueue* exportQueue = nullptr;
+    QProgressBar* exportProgress = nullptr;
+
+    // Edit-to-pixels latency, shown in the status bar.
+    QLabel* latencyLabel = nullptr;
+    qint64 editStartNs = -1;
+    MatPool::Counters editStartCounters;
+    QVector<double> recentLatenciesMs;
+
     QGraphicsView* viewOriginal = nullptr;
     QGraphicsView* viewProcessed = nullptr;
     QGraphicsScene* sceneOriginal = nullptr;
     QGraphicsScene* sceneProcessed = nullptr;
+    TiledImageItem* originalItem = nullptr;
+    TiledImageItem* processedItem = nullptr;
+    QGraphicsTextItem* originalPlaceholder = nullptr;
+    QGraphicsTextItem* processedPlaceholder = nullptr;
+    quint64 shownGeneration = 0;
     QComboBox* cbFilter = nullptr;
     QSpinBox* sbKsize = nullptr;
     QDoubleSpinBox* dsSigma = nullptr;
@@ -72,14 +149,44 @@ private:
     QSpinBox* sbHigh = nullptr;
     QSlider* sBrightness = nullptr;
     QDoubleSpinBox* dsContrast = nullptr;
+    QDoubleSpinBox* dsGamma = nullptr;
+    QSpinBox* sbThreshold = nullptr;
+    QComboBox* cbFreqShape = nullptr;
+    QDoubleSpinBox* dsCutoff = nullptr;
+    QSpinBox* sbOrder = nullptr;
+    QSpinBox* sbNotchU = nullptr;
+    QSpinBox* sbNotchV = nullptr;
+    QDoubleSpinBox* dsNotchRadius = nullptr;
+    QCheckBox* cbPreview = nullptr;
+    QTimer* refineTimer = nullptr;
+    // Zoomed in on a large image, only the visible part (plus a margin) is
+    // rendered and drawn over the processed item; panning renders more.
+    TiledImageItem* regionItem = nullptr;
+    QTimer* panTimer = nullptr;
+    cv::Rect shownRegion;
+    QByteArray shownRegionKey;
+    cv::Rect pendingRegion;
+    QByteArray pendingRegionKey;
+    quint64 pendingRegionRequest = 0;
     QLabel* lbBrightness = nullptr;
     QLabel* detailsLabel = nullptr;
     QDockWidget* historyDock = nullptr;
     QListWidget* historyList = nullptr;
+    QListWidget* stageList = nullptr;
     QToolBar* mainTb = nullptr;
     QMenu* openRecentMenu = nullptr;
     QStringList recentFiles;
-    FilterConfig cfg;
+    ThumbnailCache* thumbnails = nullptr;
+    // Decode of the most recent file that is not open, made ahead of time.
+    struct Prefetched {
+        QString path;
+        qint64 mtime = 0;
+        cv::Mat image;
+        quint64 hash = 0;
+    } prefetched;
+    QList<FilterConfig> stages { FilterConfig{ "Nenhum" } };
+    int currentStage = 0;
+    FilterConfig cfg { "Nenhum" };
     double currentScale = 1.0;
 };
 